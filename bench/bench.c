@@ -0,0 +1,1082 @@
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "functions.h"
+
+/*
+ * Micro/macro benchmark suite for the core structures
+ *
+ * Every workload is run for each size (powers of ten between --min-size and
+ * --max-size), each key pattern and each thread count. With several threads,
+ * each thread drives its own instance (the structures are not thread-safe),
+ * except for the multi-queue, which all threads share. They split its operations
+ * between them, so the queue sees the same total work as with one thread. The
+ * ops column always counts the operations of all threads together (format v2;
+ * v1 counted one thread's). Operations are timed in batches so percentiles can be
+ * reported without the clock dominating the cost.
+ * Output is CSV (default) or JSON Lines so results can be diffed between commits.
+ */
+
+#define BATCH_OPS 64                // Operations timed together as one latency sample
+#define LIST_AT_OPS 1000            // ll_insert_at calls per run (each one walks the list)
+#define LIST_AT_MAX_SIZE 100000     // Larger lists make ll_insert_at runs take minutes
+#define ADVERSARIAL_HASH_MAX 10000  // Colliding keys make hash operations O(n) each
+#define KEY_WIDTH 64                // Bytes reserved per generated key string
+#define ZIPF_THETA 0.99             // Skew used for the zipfian pattern
+
+// Key/value patterns, usable as a bit mask
+enum {
+    PATTERN_UNIFORM = 1,
+    PATTERN_ZIPFIAN = 2,
+    PATTERN_ADVERSARIAL = 4
+};
+
+enum {
+    FORMAT_CSV,
+    FORMAT_JSON
+};
+
+static const char *pattern_names[] = {"uniform", "zipfian", "adversarial"};
+
+// Input shared read-only by every thread of a run
+typedef struct Keys {
+    int pattern;
+    size_t size;
+    double *values;     // Values for push/enqueue/insert, in insertion order
+    size_t *order;      // Index sequence for lookups and positional inserts
+    size_t *delete_order;   // Permutation of [0, size) in the pattern's order, so each delete hits
+    char *hit_keys;     // size keys of KEY_WIDTH bytes each
+    char *miss_keys;    // size keys that are never inserted
+} Keys;
+
+// A single benchmarked operation
+typedef struct Workload {
+    const char *structure;
+    const char *operation;
+    void *(*setup)(const Keys *keys);                   // Builds the starting state, untimed
+    void (*run)(void *state, const Keys *keys, size_t begin, size_t end);
+    void (*teardown)(void *state);
+    size_t (*ops)(size_t size);                         // Operations per run (NULL means size)
+    size_t (*max_size)(int pattern);                    // Largest size worth running (NULL means any)
+    int shared;     // One state used by every thread instead of one per thread
+} Workload;
+
+typedef struct Config {
+    size_t min_size;
+    size_t max_size;
+    int patterns;
+    size_t thread_counts[16];
+    size_t num_thread_counts;
+    unsigned repeats;
+    int format;
+    const char *filter;     // Only run workloads whose "structure.operation" contains this
+    uint64_t seed;
+} Config;
+
+/* ---------- Utilities ---------- */
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double uniform01(uint64_t *state) {
+    return (double) (splitmix64(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, size_t count, double p) {
+    if (count == 0) {
+        return NAN;
+    }
+
+    size_t index = (size_t) (p * (double) (count - 1) + 0.5);
+    return sorted[index];
+}
+
+/*
+ * Zipfian rank generator (Gray et al., "Quickly generating billion-record
+ * synthetic databases"), the same construction YCSB uses
+ */
+typedef struct Zipf {
+    size_t n;
+    double zetan;
+    double alpha;
+    double eta;
+} Zipf;
+
+static void zipf_init(Zipf *z, size_t n) {
+    double zeta2 = 1.0 + pow(0.5, ZIPF_THETA);
+
+    z->n = n;
+    z->zetan = 0.0;
+    for (size_t i = 1; i <= n; i++) {
+        z->zetan += 1.0 / pow((double) i, ZIPF_THETA);
+    }
+    z->alpha = 1.0 / (1.0 - ZIPF_THETA);
+    z->eta = (1.0 - pow(2.0 / (double) n, 1.0 - ZIPF_THETA)) / (1.0 - zeta2 / z->zetan);
+}
+
+static size_t zipf_next(const Zipf *z, uint64_t *state) {
+    double u = uniform01(state);
+    double uz = u * z->zetan;
+
+    if (uz < 1.0) {
+        return 0;
+    }
+
+    if (uz < 1.0 + pow(0.5, ZIPF_THETA)) {
+        return 1;
+    }
+
+    size_t rank = (size_t) ((double) z->n * pow(z->eta * u - z->eta + 1.0, z->alpha));
+    return rank < z->n ? rank : z->n - 1;
+}
+
+/*
+ * Writes the i-th of 2^k strings that all share one djb2 hash
+ * "Ez" and "FY" hash identically, so any sequence of those blocks collides
+ */
+static void colliding_key(char *out, size_t i, size_t blocks) {
+    for (size_t b = 0; b < blocks; b++) {
+        const char *block = ((i >> b) & 1) ? "FY" : "Ez";
+        out[2 * b] = block[0];
+        out[2 * b + 1] = block[1];
+    }
+    out[2 * blocks] = '\0';
+}
+
+static int keys_build(Keys *keys, int pattern, size_t size, uint64_t seed) {
+    uint64_t state = seed ^ (uint64_t) size * 0x100000001B3ULL ^ (uint64_t) pattern;
+
+    keys->pattern = pattern;
+    keys->size = size;
+    keys->values = malloc(size * sizeof(double));
+    keys->order = malloc(size * sizeof(size_t));
+    keys->delete_order = NULL;
+    keys->hit_keys = NULL;
+    keys->miss_keys = NULL;
+
+    if (!keys->values || !keys->order) {
+        return -1;
+    }
+
+    Zipf zipf;
+    if (pattern == PATTERN_ZIPFIAN) {
+        zipf_init(&zipf, size);
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        switch (pattern) {
+        case PATTERN_UNIFORM:
+            keys->values[i] = uniform01(&state) * 1e6;
+            keys->order[i] = (size_t) (splitmix64(&state) % size);
+            break;
+        case PATTERN_ZIPFIAN: {
+            // Scatter hot ranks over the key space so they are not simply the oldest keys
+            size_t rank = zipf_next(&zipf, &state);
+            keys->values[i] = (double) rank;
+            keys->order[i] = (size_t) ((rank * 0x9E3779B97F4A7C15ULL) % size);
+            break;
+        }
+        default:
+            // Ascending values make every max-heap insert climb to the root
+            keys->values[i] = (double) i;
+            keys->order[i] = size - 1 - i;
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Fills delete_order with every index once; order[] draws with replacement, so
+ * deleting in that order would mostly time misses on keys already gone
+ * Uniform keys are shuffled, zipfian keys keep the order in which ranks are first
+ * drawn (hot keys first) followed by the keys never drawn, adversarial keys reuse order[]
+ */
+static int keys_build_delete_order(Keys *keys, uint64_t seed) {
+    size_t size = keys->size;
+    size_t *out = keys->delete_order;
+
+    if (keys->pattern == PATTERN_UNIFORM) {
+        uint64_t state = seed ^ (uint64_t) size * 0x9E3779B97F4A7C15ULL;
+
+        for (size_t i = 0; i < size; i++) {
+            out[i] = i;
+        }
+        for (size_t i = size; i > 1; i--) {
+            size_t j = (size_t) (splitmix64(&state) % i);
+            size_t swap = out[i - 1];
+            out[i - 1] = out[j];
+            out[j] = swap;
+        }
+    }
+    else if (keys->pattern == PATTERN_ZIPFIAN) {
+        unsigned char *seen = calloc(size, 1);
+        size_t count = 0;
+
+        if (!seen) {
+            return -1;
+        }
+
+        for (size_t i = 0; i < size; i++) {
+            if (!seen[keys->order[i]]) {
+                seen[keys->order[i]] = 1;
+                out[count++] = keys->order[i];
+            }
+        }
+        for (size_t i = 0; i < size; i++) {
+            if (!seen[i]) {
+                out[count++] = i;
+            }
+        }
+
+        free(seen);
+    }
+    else {
+        memcpy(out, keys->order, size * sizeof(size_t));
+    }
+
+    return 0;
+}
+
+static int keys_build_strings(Keys *keys, uint64_t seed) {
+    if (keys->hit_keys) {
+        return 0;
+    }
+
+    size_t size = keys->size;
+    keys->hit_keys = malloc(size * KEY_WIDTH);
+    keys->miss_keys = malloc(size * KEY_WIDTH);
+    keys->delete_order = malloc(size * sizeof(size_t));
+
+    if (!keys->hit_keys || !keys->miss_keys || !keys->delete_order) {
+        return -1;
+    }
+
+    if (keys_build_delete_order(keys, seed) != 0) {
+        return -1;
+    }
+
+    size_t blocks = 1;
+    while (((size_t) 1 << blocks) < 2 * size) {
+        blocks++;
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        char *hit = keys->hit_keys + i * KEY_WIDTH;
+        char *miss = keys->miss_keys + i * KEY_WIDTH;
+
+        if (keys->pattern == PATTERN_ADVERSARIAL) {
+            // Hits use the low half of the collision family and misses the high half
+            colliding_key(hit, i, blocks);
+            colliding_key(miss, i | ((size_t) 1 << (blocks - 1)), blocks);
+        }
+        else {
+            uint64_t mixed = i * 0x9E3779B97F4A7C15ULL ^ seed;
+            snprintf(hit, KEY_WIDTH, "key:%016llx:%zu", (unsigned long long) mixed, i);
+            snprintf(miss, KEY_WIDTH, "miss:%016llx:%zu", (unsigned long long) mixed, i);
+        }
+    }
+
+    return 0;
+}
+
+static void keys_free(Keys *keys) {
+    free(keys->values);
+    free(keys->order);
+    free(keys->delete_order);
+    free(keys->hit_keys);
+    free(keys->miss_keys);
+}
+
+static char *hit_key(const Keys *keys, size_t i) {
+    return keys->hit_keys + (i % keys->size) * KEY_WIDTH;
+}
+
+static char *miss_key(const Keys *keys, size_t i) {
+    return keys->miss_keys + (i % keys->size) * KEY_WIDTH;
+}
+
+/* ---------- Hardware counters ---------- */
+
+#define NUM_COUNTERS 4
+
+static const char *counter_names[NUM_COUNTERS] = {
+    "cycles", "instructions", "cache_misses", "branch_misses"
+};
+
+typedef struct Counters {
+    int fds[NUM_COUNTERS];
+    uint64_t values[NUM_COUNTERS];
+    int available;
+} Counters;
+
+static void counters_open(Counters *c) {
+    c->available = 0;
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        c->fds[i] = -1;
+        c->values[i] = 0;
+    }
+
+#ifdef __linux__
+    static const uint64_t configs[NUM_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        // Counts the calling thread only, on whichever CPU it runs
+        c->fds[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (c->fds[i] >= 0) {
+            c->available = 1;
+        }
+    }
+#endif
+}
+
+static void counters_start(Counters *c) {
+#ifdef __linux__
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        if (c->fds[i] >= 0) {
+            ioctl(c->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(c->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#else
+    (void) c;
+#endif
+}
+
+static void counters_stop(Counters *c) {
+#ifdef __linux__
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        if (c->fds[i] >= 0) {
+            uint64_t value = 0;
+            ioctl(c->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(c->fds[i], &value, sizeof(value)) == sizeof(value)) {
+                c->values[i] = value;
+            }
+        }
+    }
+#else
+    (void) c;
+#endif
+}
+
+static void counters_close(Counters *c) {
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        if (c->fds[i] >= 0) {
+            close(c->fds[i]);
+        }
+    }
+}
+
+/* ---------- Workloads ---------- */
+
+static size_t list_at_ops(size_t size) {
+    return size < LIST_AT_OPS ? size : LIST_AT_OPS;
+}
+
+static size_t list_at_max_size(int pattern) {
+    (void) pattern;
+    return LIST_AT_MAX_SIZE;
+}
+
+static size_t hash_max_size(int pattern) {
+    return pattern == PATTERN_ADVERSARIAL ? ADVERSARIAL_HASH_MAX : (size_t) -1;
+}
+
+// Stack
+
+static void *stack_empty(const Keys *keys) {
+    (void) keys;
+    return s_create();
+}
+
+static void *stack_filled(const Keys *keys) {
+    Stack *s = s_create();
+    for (size_t i = 0; s && i < keys->size; i++) {
+        s_push(s, keys->values[i]);
+    }
+    return s;
+}
+
+static void stack_push(void *state, const Keys *keys, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        s_push(state, keys->values[i]);
+    }
+}
+
+static void stack_pop(void *state, const Keys *keys, size_t begin, size_t end) {
+    (void) keys;
+    for (size_t i = begin; i < end; i++) {
+        s_pop(state);
+    }
+}
+
+static void stack_free(void *state) {
+    s_free(state);
+}
+
+// Queue
+
+static void *queue_empty(const Keys *keys) {
+    (void) keys;
+    return q_create();
+}
+
+static void *queue_filled(const Keys *keys) {
+    Queue *q = q_create();
+    for (size_t i = 0; q && i < keys->size; i++) {
+        q_enqueue(q, keys->values[i]);
+    }
+    return q;
+}
+
+static void queue_enqueue(void *state, const Keys *keys, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        q_enqueue(state, keys->values[i]);
+    }
+}
+
+static void queue_dequeue(void *state, const Keys *keys, size_t begin, size_t end) {
+    (void) keys;
+    for (size_t i = begin; i < end; i++) {
+        q_dequeue(state);
+    }
+}
+
+static void queue_free(void *state) {
+    q_free(state);
+}
+
+// Linked list
+
+static void *list_empty(const Keys *keys) {
+    (void) keys;
+    return ll_create();
+}
+
+static void *list_filled(const Keys *keys) {
+    LinkedList *ll = ll_create();
+    for (size_t i = 0; ll && i < keys->size; i++) {
+        ll_insert_tail(ll, keys->values[i]);
+    }
+    return ll;
+}
+
+static void list_insert_head(void *state, const Keys *keys, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        ll_insert_head(state, keys->values[i]);
+    }
+}
+
+static void list_insert_tail(void *state, const Keys *keys, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        ll_insert_tail(state, keys->values[i]);
+    }
+}
+
+static void list_insert_at(void *state, const Keys *keys, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        // The list holds size + i elements; adversarial inserts walk almost all of them
+        size_t length = keys->size + i;
+        size_t index = keys->pattern == PATTERN_ADVERSARIAL ? length - 1 : keys->order[i] % length;
+        ll_insert_at(state, keys->values[i], index);
+    }
+}
+
+static void list_remove_head(void *state, const Keys *keys, size_t begin, size_t end) {
+    (void) keys;
+    for (size_t i = begin; i < end; i++) {
+        ll_remove_head(state);
+    }
+}
+
+static void list_free(void *state) {
+    ll_free(state);
+}
+
+// Hash table
+
+static void *table_empty(const Keys *keys) {
+    (void) keys;
+    return ht_create();
+}
+
+static void *table_filled(const Keys *keys) {
+    HashTable *ht = ht_create();
+    for (size_t i = 0; ht && i < keys->size; i++) {
+        ht_insert(ht, hit_key(keys, i), keys->values[i]);
+    }
+    return ht;
+}
+
+static void table_insert(void *state, const Keys *keys, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        ht_insert(state, hit_key(keys, i), keys->values[i]);
+    }
+}
+
+static void table_search_hit(void *state, const Keys *keys, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        ht_search(state, hit_key(keys, keys->order[i]));
+    }
+}
+
+static void table_search_miss(void *state, const Keys *keys, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        ht_search(state, miss_key(keys, keys->order[i]));
+    }
+}
+
+static void table_delete(void *state, const Keys *keys, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        ht_delete(state, hit_key(keys, keys->delete_order[i]));
+    }
+}
+
+static void table_free(void *state) {
+    ht_free(state);
+}
+
+// Heap
+
+static void *heap_empty(const Keys *keys) {
+    (void) keys;
+    return h_create();
+}
+
+static void *heap_filled(const Keys *keys) {
+    Heap *h = h_create();
+    for (size_t i = 0; h && i < keys->size; i++) {
+        h_insert(h, keys->values[i]);
+    }
+    return h;
+}
+
+static void heap_insert(void *state, const Keys *keys, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        h_insert(state, keys->values[i]);
+    }
+}
+
+static void heap_pop_max(void *state, const Keys *keys, size_t begin, size_t end) {
+    (void) keys;
+    for (size_t i = begin; i < end; i++) {
+        h_pop_max(state);
+    }
+}
+
+static void heap_free(void *state) {
+    h_free(state);
+}
+
+// Concurrent multi-queue, shared by every thread of a run
+
+static void *multi_queue_empty(const Keys *keys) {
+    (void) keys;
+    return mq_create(0);
+}
+
+static void *multi_queue_filled(const Keys *keys) {
+    MultiQueue *mq = mq_create(0);
+    for (size_t i = 0; mq && i < keys->size; i++) {
+        mq_insert(mq, keys->values[i]);
+    }
+    return mq;
+}
+
+static void multi_queue_insert(void *state, const Keys *keys, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        mq_insert(state, keys->values[i]);
+    }
+}
+
+static void multi_queue_pop_max(void *state, const Keys *keys, size_t begin, size_t end) {
+    (void) keys;
+    for (size_t i = begin; i < end; i++) {
+        mq_pop_max(state);
+    }
+}
+
+static void multi_queue_free(void *state) {
+    mq_free(state);
+}
+
+static const Workload workloads[] = {
+    {"stack", "s_push", stack_empty, stack_push, stack_free, NULL, NULL, 0},
+    {"stack", "s_pop", stack_filled, stack_pop, stack_free, NULL, NULL, 0},
+    {"queue", "q_enqueue", queue_empty, queue_enqueue, queue_free, NULL, NULL, 0},
+    {"queue", "q_dequeue", queue_filled, queue_dequeue, queue_free, NULL, NULL, 0},
+    {"linked_list", "ll_insert_head", list_empty, list_insert_head, list_free, NULL, NULL, 0},
+    {"linked_list", "ll_insert_tail", list_empty, list_insert_tail, list_free, NULL, NULL, 0},
+    {"linked_list", "ll_insert_at", list_filled, list_insert_at, list_free, list_at_ops, list_at_max_size, 0},
+    {"linked_list", "ll_remove_head", list_filled, list_remove_head, list_free, NULL, NULL, 0},
+    {"hash_table", "ht_insert", table_empty, table_insert, table_free, NULL, hash_max_size, 0},
+    {"hash_table", "ht_search_hit", table_filled, table_search_hit, table_free, NULL, hash_max_size, 0},
+    {"hash_table", "ht_search_miss", table_filled, table_search_miss, table_free, NULL, hash_max_size, 0},
+    {"hash_table", "ht_delete", table_filled, table_delete, table_free, NULL, hash_max_size, 0},
+    {"heap", "h_insert", heap_empty, heap_insert, heap_free, NULL, NULL, 0},
+    {"heap", "h_pop_max", heap_filled, heap_pop_max, heap_free, NULL, NULL, 0},
+    {"multi_queue", "mq_insert", multi_queue_empty, multi_queue_insert, multi_queue_free, NULL, NULL, 1},
+    {"multi_queue", "mq_pop_max", multi_queue_filled, multi_queue_pop_max, multi_queue_free, NULL, NULL, 1},
+};
+
+#define NUM_WORKLOADS (sizeof(workloads) / sizeof(workloads[0]))
+
+/* ---------- Runner ---------- */
+
+// Per-thread state for one run of one workload
+typedef struct Worker {
+    const Workload *workload;
+    const Keys *keys;
+    size_t begin;           // Operations [begin, end) of the run fall to this worker
+    size_t end;
+    void *shared_state;     // Set for shared workloads, otherwise each worker builds its own
+    pthread_barrier_t *barrier;
+    double *samples;        // ns/op of each batch
+    size_t num_samples;
+    uint64_t elapsed_ns;
+    Counters counters;
+    int failed;
+} Worker;
+
+static void *worker_main(void *arg) {
+    Worker *w = arg;
+    void *state = w->workload->shared ? w->shared_state : w->workload->setup(w->keys);
+
+    if (!state) {
+        w->failed = 1;
+    }
+
+    counters_open(&w->counters);
+    pthread_barrier_wait(w->barrier);
+
+    if (!w->failed) {
+        counters_start(&w->counters);
+        uint64_t start = now_ns();
+
+        for (size_t begin = w->begin; begin < w->end; begin += BATCH_OPS) {
+            size_t end = begin + BATCH_OPS < w->end ? begin + BATCH_OPS : w->end;
+            uint64_t t0 = now_ns();
+            w->workload->run(state, w->keys, begin, end);
+            uint64_t t1 = now_ns();
+            w->samples[w->num_samples++] = (double) (t1 - t0) / (double) (end - begin);
+        }
+
+        w->elapsed_ns = now_ns() - start;
+        counters_stop(&w->counters);
+
+        if (!w->workload->shared) {
+            w->workload->teardown(state);
+        }
+    }
+
+    counters_close(&w->counters);
+
+    return NULL;
+}
+
+typedef struct Result {
+    double ns_per_op;       // Median over repeats of the mean batch cost
+    double p50, p90, p99, p999;
+    double mops;            // Aggregate throughput over all threads (best repeat)
+    double counters[NUM_COUNTERS];  // Per operation, NAN if unavailable
+    size_t ops;             // Operations per repeat across all threads
+} Result;
+
+static int run_workload(const Workload *workload, const Keys *keys, size_t threads,
+                        unsigned repeats, Result *result) {
+    size_t ops = workload->ops ? workload->ops(keys->size) : keys->size;
+    size_t batches = (ops + BATCH_OPS - 1) / BATCH_OPS;
+    size_t total_ops = workload->shared ? ops : ops * threads;     // Operations per repeat, all threads
+    size_t capacity = batches * threads * repeats;
+    double *all_samples = malloc((capacity ? capacity : 1) * sizeof(double));
+    double *repeat_means = malloc(repeats * sizeof(double));
+    Worker *workers = calloc(threads, sizeof(Worker));
+    pthread_t *ids = malloc(threads * sizeof(pthread_t));
+    size_t total_samples = 0;
+    int status = 0;
+
+    if (!all_samples || !repeat_means || !workers || !ids) {
+        free(all_samples);
+        free(repeat_means);
+        free(workers);
+        free(ids);
+        return -1;
+    }
+
+    result->mops = 0.0;
+    result->ops = total_ops;
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        result->counters[c] = NAN;
+    }
+
+    for (unsigned r = 0; r < repeats && status == 0; r++) {
+        pthread_barrier_t barrier;
+        pthread_barrier_init(&barrier, NULL, (unsigned) threads);
+
+        void *shared_state = workload->shared ? workload->setup(keys) : NULL;
+
+        for (size_t t = 0; t < threads; t++) {
+            workers[t] = (Worker) {
+                .workload = workload,
+                .keys = keys,
+                .begin = workload->shared ? t * ops / threads : 0,
+                .end = workload->shared ? (t + 1) * ops / threads : ops,
+                .shared_state = shared_state,
+                .barrier = &barrier,
+                .samples = all_samples + total_samples + t * batches,
+            };
+            pthread_create(&ids[t], NULL, worker_main, &workers[t]);
+        }
+
+        uint64_t slowest = 0;
+        double total_ns = 0.0;
+        uint64_t counter_totals[NUM_COUNTERS] = {0};
+        int counters_seen = 0;
+
+        for (size_t t = 0; t < threads; t++) {
+            pthread_join(ids[t], NULL);
+            if (workers[t].failed) {
+                status = -1;
+                continue;
+            }
+            slowest = workers[t].elapsed_ns > slowest ? workers[t].elapsed_ns : slowest;
+            total_ns += (double) workers[t].elapsed_ns;
+            if (workers[t].counters.available) {
+                counters_seen = 1;
+                for (int c = 0; c < NUM_COUNTERS; c++) {
+                    counter_totals[c] += workers[t].counters.values[c];
+                }
+            }
+        }
+
+        pthread_barrier_destroy(&barrier);
+
+        if (shared_state) {
+            workload->teardown(shared_state);
+        }
+
+        if (status != 0) {
+            break;
+        }
+
+        // Pack this repeat's samples, since workers of a shared run fill fewer than batches
+        for (size_t t = 0; t < threads; t++) {
+            memmove(all_samples + total_samples, workers[t].samples, workers[t].num_samples * sizeof(double));
+            total_samples += workers[t].num_samples;
+        }
+        repeat_means[r] = total_ns / (double) total_ops;
+
+        double mops = slowest ? (double) total_ops / (double) slowest * 1e3 : 0.0;
+        if (mops > result->mops) {
+            result->mops = mops;
+            if (counters_seen) {
+                for (int c = 0; c < NUM_COUNTERS; c++) {
+                    result->counters[c] = (double) counter_totals[c] / (double) total_ops;
+                }
+            }
+        }
+    }
+
+    if (status == 0) {
+        qsort(repeat_means, repeats, sizeof(double), compare_doubles);
+        qsort(all_samples, total_samples, sizeof(double), compare_doubles);
+
+        result->ns_per_op = repeat_means[repeats / 2];
+        result->p50 = percentile(all_samples, total_samples, 0.50);
+        result->p90 = percentile(all_samples, total_samples, 0.90);
+        result->p99 = percentile(all_samples, total_samples, 0.99);
+        result->p999 = percentile(all_samples, total_samples, 0.999);
+    }
+
+    free(all_samples);
+    free(repeat_means);
+    free(workers);
+    free(ids);
+
+    return status;
+}
+
+/* ---------- Output ---------- */
+
+static void print_header(const Config *config) {
+    if (config->format == FORMAT_CSV) {
+        printf("# lds-bench v2 seed=%llu repeats=%u batch_ops=%d\n",
+               (unsigned long long) config->seed, config->repeats, BATCH_OPS);
+        printf("structure,operation,pattern,size,threads,ops,ns_per_op,p50_ns,p90_ns,p99_ns,p999_ns,mops");
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            printf(",%s_per_op", counter_names[c]);
+        }
+        printf("\n");
+    }
+    else {
+        printf("{\"type\":\"meta\",\"version\":2,\"seed\":%llu,\"repeats\":%u,\"batch_ops\":%d}\n",
+               (unsigned long long) config->seed, config->repeats, BATCH_OPS);
+    }
+}
+
+static void print_number(double value, int json) {
+    if (!isnan(value)) {
+        printf("%.3f", value);
+    }
+    else if (json) {
+        printf("null");
+    }
+}
+
+static void print_result(const Config *config, const Workload *workload, int pattern,
+                         size_t size, size_t threads, const Result *r) {
+    const char *pattern_name = pattern_names[pattern == PATTERN_UNIFORM ? 0 : pattern == PATTERN_ZIPFIAN ? 1 : 2];
+    double stats[] = {r->ns_per_op, r->p50, r->p90, r->p99, r->p999, r->mops};
+    static const char *stat_names[] = {"ns_per_op", "p50_ns", "p90_ns", "p99_ns", "p999_ns", "mops"};
+    int json = config->format == FORMAT_JSON;
+
+    if (json) {
+        printf("{\"type\":\"result\",\"structure\":\"%s\",\"operation\":\"%s\",\"pattern\":\"%s\","
+               "\"size\":%zu,\"threads\":%zu,\"ops\":%zu",
+               workload->structure, workload->operation, pattern_name, size, threads, r->ops);
+    }
+    else {
+        printf("%s,%s,%s,%zu,%zu,%zu", workload->structure, workload->operation, pattern_name,
+               size, threads, r->ops);
+    }
+
+    for (size_t i = 0; i < sizeof(stats) / sizeof(stats[0]); i++) {
+        printf(json ? ",\"%s\":" : ",", stat_names[i]);
+        print_number(stats[i], json);
+    }
+
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (json) {
+            printf(",\"%s_per_op\":", counter_names[c]);
+        }
+        else {
+            printf(",");
+        }
+        print_number(r->counters[c], json);
+    }
+
+    printf(json ? "}\n" : "\n");
+    fflush(stdout);
+}
+
+/* ---------- Command line ---------- */
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --min-size N       smallest size (default 100)\n"
+            "  --max-size N       largest size, sizes step by 10x (default 1000000, up to 100000000)\n"
+            "  --patterns LIST    comma-separated: uniform,zipfian,adversarial (default all)\n"
+            "  --threads LIST     comma-separated thread counts (default 1 and every online CPU)\n"
+            "  --repeats N        runs per configuration (default 3)\n"
+            "  --filter TEXT      only run operations whose structure.operation contains TEXT\n"
+            "  --format csv|json  output format (default csv)\n"
+            "  --seed N           random seed (default 42)\n",
+            program);
+}
+
+static int parse_args(int argc, char **argv, Config *config) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    config->min_size = 100;
+    config->max_size = 1000000;
+    config->patterns = PATTERN_UNIFORM | PATTERN_ZIPFIAN | PATTERN_ADVERSARIAL;
+    config->thread_counts[0] = 1;
+    config->num_thread_counts = 1;
+    if (cpus > 1) {
+        config->thread_counts[config->num_thread_counts++] = (size_t) cpus;
+    }
+    config->repeats = 3;
+    config->format = FORMAT_CSV;
+    config->filter = NULL;
+    config->seed = 42;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            usage(argv[0]);
+            exit(0);
+        }
+
+        if (!value) {
+            usage(argv[0]);
+            return -1;
+        }
+        i++;
+
+        if (strcmp(arg, "--min-size") == 0) {
+            config->min_size = strtoull(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--max-size") == 0) {
+            config->max_size = strtoull(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--repeats") == 0) {
+            config->repeats = (unsigned) strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--filter") == 0) {
+            config->filter = value;
+        }
+        else if (strcmp(arg, "--seed") == 0) {
+            config->seed = strtoull(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--format") == 0) {
+            config->format = strcmp(value, "json") == 0 ? FORMAT_JSON : FORMAT_CSV;
+        }
+        else if (strcmp(arg, "--patterns") == 0) {
+            config->patterns = 0;
+            if (strstr(value, "uniform")) config->patterns |= PATTERN_UNIFORM;
+            if (strstr(value, "zipf")) config->patterns |= PATTERN_ZIPFIAN;
+            if (strstr(value, "adversarial")) config->patterns |= PATTERN_ADVERSARIAL;
+        }
+        else if (strcmp(arg, "--threads") == 0) {
+            char *cursor = (char *) value;
+            config->num_thread_counts = 0;
+            while (*cursor && config->num_thread_counts < 16) {
+                size_t count = strtoull(cursor, &cursor, 10);
+                if (count > 0) {
+                    config->thread_counts[config->num_thread_counts++] = count;
+                }
+                if (*cursor == ',') {
+                    cursor++;
+                }
+                else if (*cursor) {
+                    break;
+                }
+            }
+        }
+        else {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (config->min_size == 0 || config->max_size < config->min_size ||
+        config->repeats == 0 || config->patterns == 0 || config->num_thread_counts == 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int workload_selected(const Config *config, const Workload *workload) {
+    if (!config->filter) {
+        return 1;
+    }
+
+    char name[128];
+    snprintf(name, sizeof(name), "%s.%s", workload->structure, workload->operation);
+    return strstr(name, config->filter) != NULL;
+}
+
+int main(int argc, char **argv) {
+    Config config;
+
+    if (parse_args(argc, argv, &config) != 0) {
+        return 1;
+    }
+
+    print_header(&config);
+
+    for (size_t size = config.min_size; size <= config.max_size; size *= 10) {
+        for (int pattern = PATTERN_UNIFORM; pattern <= PATTERN_ADVERSARIAL; pattern <<= 1) {
+            if (!(config.patterns & pattern)) {
+                continue;
+            }
+
+            Keys keys;
+            if (keys_build(&keys, pattern, size, config.seed) != 0) {
+                fprintf(stderr, "out of memory building keys for size %zu\n", size);
+                keys_free(&keys);
+                return 1;
+            }
+
+            for (size_t w = 0; w < NUM_WORKLOADS; w++) {
+                const Workload *workload = &workloads[w];
+
+                if (!workload_selected(&config, workload)) {
+                    continue;
+                }
+
+                if (workload->max_size && size > workload->max_size(pattern)) {
+                    continue;
+                }
+
+                if (strcmp(workload->structure, "hash_table") == 0 &&
+                    keys_build_strings(&keys, config.seed) != 0) {
+                    fprintf(stderr, "out of memory building keys for size %zu\n", size);
+                    continue;
+                }
+
+                for (size_t t = 0; t < config.num_thread_counts; t++) {
+                    Result result;
+                    size_t threads = config.thread_counts[t];
+
+                    if (run_workload(workload, &keys, threads, config.repeats, &result) != 0) {
+                        fprintf(stderr, "%s.%s failed at size %zu\n",
+                                workload->structure, workload->operation, size);
+                        continue;
+                    }
+
+                    print_result(&config, workload, pattern, size, threads, &result);
+                }
+            }
+
+            keys_free(&keys);
+        }
+
+        // Stop before the multiplication overflows
+        if (size > (size_t) -1 / 10) {
+            break;
+        }
+    }
+
+    return 0;
+}
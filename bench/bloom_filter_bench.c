@@ -0,0 +1,137 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "functions.h"
+
+#define DEFAULT_KEYS 1000000    // Keys stored in the table
+#define LOOKUPS_PER_KEY 4       // Lookups timed per stored key
+#define HIT_PERCENT 20          // Share of lookups for stored keys, matching a miss-heavy workload
+#define KEY_LENGTH 32
+
+/*
+ * Measures ht_search with no filter and with filters at several target false
+ * positive rates: the false positive rate actually reached, the filter's
+ * memory per key, and the cost of a lookup that misses and one that hits
+ */
+
+static const double rates[] = {0.1, 0.03, 0.01, 0.001, 0.0001};
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+/*
+ * Times lookups of the given keys and returns nanoseconds per lookup
+ */
+static double time_lookups(HashTable *ht, char (*keys)[KEY_LENGTH], size_t count, double *checksum) {
+    double start = now_seconds();
+
+    for (size_t i = 0; i < count; i++) {
+        double value = ht_search(ht, keys[i]);
+        if (!isnan(value)) {
+            *checksum += value;
+        }
+    }
+
+    return (now_seconds() - start) * 1e9 / (double) count;
+}
+
+int main(int argc, char **argv) {
+    size_t key_count = DEFAULT_KEYS;
+
+    if (argc > 1) {
+        key_count = strtoull(argv[1], NULL, 10);
+    }
+
+    size_t lookup_count = key_count * LOOKUPS_PER_KEY;
+    size_t hit_count = lookup_count * HIT_PERCENT / 100;
+    size_t miss_count = lookup_count - hit_count;
+
+    char (*hits)[KEY_LENGTH] = malloc(hit_count * KEY_LENGTH);
+    char (*misses)[KEY_LENGTH] = malloc(miss_count * KEY_LENGTH);
+    HashTable *ht = ht_create();
+
+    if (!hits || !misses || !ht) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    char key[KEY_LENGTH];
+
+    for (size_t i = 0; i < key_count; i++) {
+        snprintf(key, sizeof(key), "user:%zu", i);
+        ht_insert(ht, key, (double) i);
+    }
+
+    // Lookup keys are drawn up front so every configuration sees the same sequence
+    for (size_t i = 0; i < hit_count; i++) {
+        snprintf(hits[i], KEY_LENGTH, "user:%llu", (unsigned long long) (next_random() % key_count));
+    }
+    for (size_t i = 0; i < miss_count; i++) {
+        snprintf(misses[i], KEY_LENGTH, "session:%llu", (unsigned long long) next_random());
+    }
+
+    printf("keys,%zu\n", key_count);
+    printf("target_fp_rate,measured_fp_rate,filter_bits_per_key,miss_ns,hit_ns,checksum\n");
+
+    for (int r = -1; r < (int) (sizeof(rates) / sizeof(rates[0])); r++) {
+        double measured = 0.0;
+        double bits_per_key = 0.0;
+
+        if (r >= 0) {
+            if (ht_attach_filter(ht, rates[r]) != 0) {
+                fprintf(stderr, "could not attach a filter\n");
+                return 1;
+            }
+
+            // A lone filter sized for exactly the stored keys gives the rate and memory;
+            // the attached one is sized for the table's next growth point, so it is no worse
+            BloomFilter *bf = bf_create(key_count, rates[r]);
+            size_t false_positives = 0;
+
+            for (size_t i = 0; i < key_count; i++) {
+                snprintf(key, sizeof(key), "user:%zu", i);
+                bf_add(bf, key);
+            }
+            for (size_t i = 0; i < miss_count; i++) {
+                false_positives += (size_t) bf_contains(bf, misses[i]);
+            }
+
+            measured = (double) false_positives / (double) miss_count;
+            bits_per_key = 8.0 * (double) bf_memory(bf) / (double) key_count;
+            bf_free(bf);
+        }
+
+        double checksum = 0.0;
+        double miss_ns = time_lookups(ht, misses, miss_count, &checksum);
+        double hit_ns = time_lookups(ht, hits, hit_count, &checksum);
+
+        if (r >= 0) {
+            printf("%g,%.5f,%.2f,%.2f,%.2f,%.0f\n", rates[r], measured, bits_per_key, miss_ns, hit_ns, checksum);
+        } else {
+            printf("none,,0,%.2f,%.2f,%.0f\n", miss_ns, hit_ns, checksum);
+        }
+    }
+
+    ht_free(ht);
+    free(hits);
+    free(misses);
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "typed_containers.h"
+
+#define BURST (1 << 20)         // Elements pushed in one burst, also the fixed capacity
+
+/*
+ * Times every operation of one burst on the growable typed containers and on
+ * their fixed-capacity variants. The means are close; the difference is in the
+ * tail, where each doubling of a growable container copies all of its elements
+ */
+
+DEFINE_STACK(u64, uint64_t)
+DEFINE_QUEUE(u64, uint64_t)
+DEFINE_FIXED_STACK(u64, uint64_t, BURST)
+DEFINE_FIXED_QUEUE(u64, uint64_t, BURST)
+
+// Fixed instances live in static storage, so the burst never touches the allocator
+static FixedStack_u64 fixed_stack;
+static FixedQueue_u64 fixed_queue;
+static uint64_t latencies[BURST];
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Prints the mean, p99.9 and maximum of the recorded latencies, which include the clock read
+ */
+static void report(const char *container, const char *operation) {
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < BURST; i++) {
+        total += latencies[i];
+    }
+
+    qsort(latencies, BURST, sizeof(uint64_t), compare_u64);
+    printf("%s,%s,%.1f,%llu,%llu\n", container, operation, (double) total / BURST,
+           (unsigned long long) latencies[BURST - BURST / 1000],
+           (unsigned long long) latencies[BURST - 1]);
+}
+
+// Times one statement per element of the burst
+#define TIME_BURST(statement)                                                               \
+    for (size_t i = 0; i < BURST; i++) {                                                    \
+        uint64_t start = now_ns();                                                          \
+        statement;                                                                          \
+        latencies[i] = now_ns() - start;                                                    \
+    }
+
+int main() {
+    uint64_t value;
+    uint64_t checksum = 0;
+
+    printf("container,operation,mean_ns,p999_ns,max_ns\n");
+
+    // Warm the fixed storage so both sides start without first-touch page faults
+    fs_u64_init(&fixed_stack);
+    fq_u64_init(&fixed_queue);
+    TIME_BURST(fs_u64_push(&fixed_stack, i));
+    TIME_BURST(fs_u64_pop(&fixed_stack, &value));
+    TIME_BURST(fq_u64_enqueue(&fixed_queue, i));
+    TIME_BURST(fq_u64_dequeue(&fixed_queue, &value));
+
+    Stack_u64 *stack = s_u64_create();
+    TIME_BURST(s_u64_push(stack, i));
+    report("stack", "push");
+    TIME_BURST(if (s_u64_pop(stack, &value) == 0) checksum += value);
+    report("stack", "pop");
+    s_u64_free(stack);
+
+    TIME_BURST(fs_u64_push(&fixed_stack, i));
+    report("fixed_stack", "push");
+    TIME_BURST(if (fs_u64_pop(&fixed_stack, &value) == 0) checksum += value);
+    report("fixed_stack", "pop");
+
+    Queue_u64 *queue = q_u64_create();
+    TIME_BURST(q_u64_enqueue(queue, i));
+    report("queue", "enqueue");
+    TIME_BURST(if (q_u64_dequeue(queue, &value) == 0) checksum += value);
+    report("queue", "dequeue");
+    q_u64_free(queue);
+
+    TIME_BURST(fq_u64_enqueue(&fixed_queue, i));
+    report("fixed_queue", "enqueue");
+    TIME_BURST(if (fq_u64_dequeue(&fixed_queue, &value) == 0) checksum += value);
+    report("fixed_queue", "dequeue");
+
+    printf("checksum,%llu\n", (unsigned long long) checksum);
+
+    return 0;
+}
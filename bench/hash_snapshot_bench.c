@@ -0,0 +1,118 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "functions.h"
+
+#define DEFAULT_KEYS 1000000    // Keys stored in the table
+#define UPDATE_PERCENT 10       // Share of the keys rewritten after each snapshot
+#define KEY_LENGTH 32
+
+/*
+ * Compares the two ways of giving a reader a point-in-time view of a table:
+ * copying every key into a new table, as was needed before ht_snapshot, and
+ * ht_snapshot itself. Also reports what the writer pays afterwards, since its
+ * first write to each chunk of buckets still shared with a snapshot copies that chunk
+ */
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+/*
+ * Rewrites the given keys and returns nanoseconds per ht_insert
+ */
+static double time_updates(HashTable *ht, char (*keys)[KEY_LENGTH], size_t count, double value) {
+    double start = now_seconds();
+
+    for (size_t i = 0; i < count; i++) {
+        ht_insert(ht, keys[i], value);
+    }
+
+    return (now_seconds() - start) * 1e9 / (double) count;
+}
+
+int main(int argc, char **argv) {
+    size_t key_count = DEFAULT_KEYS;
+
+    if (argc > 1) {
+        key_count = strtoull(argv[1], NULL, 10);
+    }
+
+    size_t update_count = key_count * UPDATE_PERCENT / 100 + 1;
+    char (*keys)[KEY_LENGTH] = malloc(key_count * KEY_LENGTH);
+    char (*updates)[KEY_LENGTH] = malloc(update_count * KEY_LENGTH);
+    HashTable *ht = ht_create();
+
+    if (!keys || !updates || !ht) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < key_count; i++) {
+        snprintf(keys[i], KEY_LENGTH, "user:%zu", i);
+        ht_insert(ht, keys[i], (double) i);
+    }
+    for (size_t i = 0; i < update_count; i++) {
+        snprintf(updates[i], KEY_LENGTH, "user:%llu", (unsigned long long) (next_random() % key_count));
+    }
+
+    printf("keys,%zu\n", key_count);
+    printf("operation,ns\n");
+
+    // The old way: a reader's private copy of the whole table
+    double start = now_seconds();
+    HashTable *copy = ht_create();
+    for (size_t i = 0; i < key_count; i++) {
+        ht_insert(copy, keys[i], ht_search(ht, keys[i]));
+    }
+    printf("full_copy,%.0f\n", (now_seconds() - start) * 1e9);
+    ht_free(copy);
+
+    start = now_seconds();
+    HashTableSnapshot *snapshot = ht_snapshot(ht);
+    printf("ht_snapshot,%.0f\n", (now_seconds() - start) * 1e9);
+
+    // Per-operation costs after the snapshot, against the same work with no snapshot alive
+    printf("ht_insert_update_after_snapshot,%.1f\n", time_updates(ht, updates, update_count, 1.0));
+    printf("ht_insert_update_again,%.1f\n", time_updates(ht, updates, update_count, 2.0));
+
+    double checksum = 0.0;
+    start = now_seconds();
+    for (size_t i = 0; i < update_count; i++) {
+        checksum += hts_search(snapshot, updates[i]);
+    }
+    printf("hts_search,%.1f\n", (now_seconds() - start) * 1e9 / (double) update_count);
+
+    start = now_seconds();
+    for (size_t i = 0; i < update_count; i++) {
+        checksum += ht_search(ht, updates[i]);
+    }
+    printf("ht_search,%.1f\n", (now_seconds() - start) * 1e9 / (double) update_count);
+
+    start = now_seconds();
+    hts_free(snapshot);
+    printf("hts_free,%.0f\n", (now_seconds() - start) * 1e9);
+    printf("checksum,%.0f\n", checksum);
+
+    ht_free(ht);
+    free(keys);
+    free(updates);
+
+    return 0;
+}
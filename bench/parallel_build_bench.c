@@ -0,0 +1,171 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "functions.h"
+
+#define KEY_LENGTH 24
+
+/*
+ * Times each bulk operation against its one-element-at-a-time equivalent, then the
+ * parallel version on pools of 1, 2, 4, ... threads up to the number of online CPUs.
+ * Rows at one size should show the same checksum for every thread count, since the
+ * parallel builds produce the same structure whatever the pool size
+ */
+
+static const size_t default_sizes[] = {1000000, 10000000};
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static void *checked(void *pointer) {
+    if (!pointer) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    return pointer;
+}
+
+/*
+ * Sums the values of a sample of the keys, so a wrong table shows up as a different checksum
+ */
+static double ht_checksum(HashTable *ht, char **keys, size_t n) {
+    double checksum = 0.0;
+
+    for (size_t i = 0; i < n; i += 97) {
+        checksum += ht_search(ht, keys[i]);
+    }
+
+    return checksum;
+}
+
+static void run_hash_table(char **keys, const double *values, size_t n, size_t max_threads) {
+    double start = now_seconds();
+    HashTable *ht = checked(ht_create());
+    for (size_t i = 0; i < n; i++) {
+        ht_insert(ht, keys[i], values[i]);
+    }
+    printf("ht_insert_loop,%zu,1,%.3f,%.0f\n", n, now_seconds() - start, ht_checksum(ht, keys, n));
+
+    // A NULL pool takes the sequential rehash
+    start = now_seconds();
+    ht_rehash_parallel(ht, NULL);
+    printf("ht_rehash,%zu,1,%.3f,%.0f\n", n, now_seconds() - start, ht_checksum(ht, keys, n));
+    ht_free(ht);
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        ThreadPool *pool = checked(tp_create(threads));
+
+        start = now_seconds();
+        ht = checked(ht_build_parallel(keys, values, n, pool));
+        printf("ht_build_parallel,%zu,%zu,%.3f,%.0f\n", n, threads, now_seconds() - start,
+               ht_checksum(ht, keys, n));
+
+        start = now_seconds();
+        ht_rehash_parallel(ht, pool);
+        printf("ht_rehash_parallel,%zu,%zu,%.3f,%.0f\n", n, threads, now_seconds() - start,
+               ht_checksum(ht, keys, n));
+
+        ht_free(ht);
+        tp_free(pool);
+    }
+}
+
+static void run_heap(const double *values, size_t n, size_t max_threads) {
+    double *sorted = checked(malloc(n * sizeof(double)));
+
+    double start = now_seconds();
+    Heap *h = checked(h_create());
+    for (size_t i = 0; i < n; i++) {
+        h_insert(h, values[i]);
+    }
+    printf("h_insert_loop,%zu,1,%.3f,%.0f\n", n, now_seconds() - start, h_peek(h));
+    h_free(h);
+
+    memcpy(sorted, values, n * sizeof(double));
+    start = now_seconds();
+    qsort(sorted, n, sizeof(double), compare_double);
+    printf("qsort,%zu,1,%.3f,%.0f\n", n, now_seconds() - start, sorted[n / 2]);
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        ThreadPool *pool = checked(tp_create(threads));
+
+        start = now_seconds();
+        h = checked(h_build_from_array(values, n, pool));
+        printf("h_build_from_array,%zu,%zu,%.3f,%.0f\n", n, threads, now_seconds() - start, h_peek(h));
+        h_free(h);
+
+        memcpy(sorted, values, n * sizeof(double));
+        start = now_seconds();
+        h_sort_parallel(sorted, n, pool);
+        printf("h_sort_parallel,%zu,%zu,%.3f,%.0f\n", n, threads, now_seconds() - start, sorted[n / 2]);
+
+        tp_free(pool);
+    }
+
+    free(sorted);
+}
+
+int main(int argc, char **argv) {
+    size_t sizes[8];
+    size_t count = 0;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_threads = cpus > 0 ? (size_t) cpus : 1;
+
+    for (int i = 1; i < argc && count < 8; i++) {
+        sizes[count++] = strtoull(argv[i], NULL, 10);
+    }
+    if (count == 0) {
+        for (size_t i = 0; i < sizeof(default_sizes) / sizeof(default_sizes[0]); i++) {
+            sizes[count++] = default_sizes[i];
+        }
+    }
+
+    printf("operation,elements,threads,seconds,checksum\n");
+
+    for (size_t s = 0; s < count; s++) {
+        size_t n = sizes[s];
+        char **keys = checked(malloc(n * sizeof(char *)));
+        char *key_storage = checked(malloc(n * KEY_LENGTH));
+        double *values = checked(malloc(n * sizeof(double)));
+
+        for (size_t i = 0; i < n; i++) {
+            keys[i] = key_storage + i * KEY_LENGTH;
+            snprintf(keys[i], KEY_LENGTH, "user:%zu", i);
+            values[i] = (double) (next_random() % 1000000000);
+        }
+
+        run_hash_table(keys, values, n, max_threads);
+        run_heap(values, n, max_threads);
+
+        free(keys);
+        free(key_storage);
+        free(values);
+    }
+
+    return 0;
+}
@@ -0,0 +1,148 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "functions.h"
+
+#define DEFAULT_OPERATIONS 10000000 // Total inserts + pops per run
+#define MAX_EDGE_WEIGHT 1000        // Largest distance increase per relaxed edge
+#define INITIAL_FRONTIER 1000       // Entries seeded before the main loop
+
+/*
+ * Dijkstra-style workload: every pop settles a distance d and relaxes a few
+ * edges by inserting d + w, so keys only ever increase
+ */
+
+static uint64_t rng_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+/*
+ * Number of edges relaxed after a pop: 0-3, averaging slightly above one so
+ * the frontier slowly grows like a real graph search
+ */
+static int edges_for_pop() {
+    uint64_t r = next_random() % 16;
+    return r < 5 ? 0 : r < 11 ? 1 : r < 15 ? 2 : 3;
+}
+
+static double run_radix(size_t operations, uint64_t *checksum) {
+    RadixHeap *rh = rh_create();
+    size_t done = 0;
+
+    for (int i = 0; i < INITIAL_FRONTIER; i++) {
+        rh_insert(rh, next_random() % MAX_EDGE_WEIGHT, 0.0);
+    }
+
+    double start = now_seconds();
+
+    while (done < operations && rh_size(rh) > 0) {
+        uint64_t distance;
+        rh_pop_min(rh, &distance);
+        *checksum += distance;
+        done++;
+
+        for (int e = edges_for_pop(); e > 0 && done < operations; e--, done++) {
+            rh_insert(rh, distance + 1 + next_random() % MAX_EDGE_WEIGHT, 0.0);
+        }
+    }
+
+    double elapsed = now_seconds() - start;
+    rh_free(rh);
+
+    return elapsed / (double) done;
+}
+
+static double run_min_heap(size_t operations, uint64_t *checksum) {
+    MinHeap *mh = mh_create();
+    size_t done = 0;
+
+    for (int i = 0; i < INITIAL_FRONTIER; i++) {
+        mh_insert(mh, (double) (next_random() % MAX_EDGE_WEIGHT));
+    }
+
+    double start = now_seconds();
+
+    while (done < operations && !isnan(mh_peek(mh))) {
+        uint64_t distance = (uint64_t) mh_pop_min(mh);
+        *checksum += distance;
+        done++;
+
+        for (int e = edges_for_pop(); e > 0 && done < operations; e--, done++) {
+            mh_insert(mh, (double) (distance + 1 + next_random() % MAX_EDGE_WEIGHT));
+        }
+    }
+
+    double elapsed = now_seconds() - start;
+    mh_free(mh);
+
+    return elapsed / (double) done;
+}
+
+static double run_max_heap(size_t operations, uint64_t *checksum) {
+    Heap *h = h_create();
+    size_t done = 0;
+
+    // The max-heap is used the way callers do today: with negated keys
+    for (int i = 0; i < INITIAL_FRONTIER; i++) {
+        h_insert(h, -(double) (next_random() % MAX_EDGE_WEIGHT));
+    }
+
+    double start = now_seconds();
+
+    while (done < operations && h_size(h) > 0) {
+        uint64_t distance = (uint64_t) -h_pop_max(h);
+        *checksum += distance;
+        done++;
+
+        for (int e = edges_for_pop(); e > 0 && done < operations; e--, done++) {
+            h_insert(h, -(double) (distance + 1 + next_random() % MAX_EDGE_WEIGHT));
+        }
+    }
+
+    double elapsed = now_seconds() - start;
+    h_free(h);
+
+    return elapsed / (double) done;
+}
+
+int main(int argc, char **argv) {
+    size_t operations = DEFAULT_OPERATIONS;
+
+    if (argc > 1) {
+        operations = strtoull(argv[1], NULL, 10);
+    }
+
+    // Every run replays the same random sequence so the checksums must agree
+    uint64_t seed = rng_state;
+    uint64_t checksums[3] = {0, 0, 0};
+
+    double radix = run_radix(operations, &checksums[0]);
+    rng_state = seed;
+    double min_heap = run_min_heap(operations, &checksums[1]);
+    rng_state = seed;
+    double max_heap = run_max_heap(operations, &checksums[2]);
+
+    printf("operations,%zu\n", operations);
+    printf("structure,ns_per_op,checksum\n");
+    printf("radix_heap,%.2f,%llu\n", radix * 1e9, (unsigned long long) checksums[0]);
+    printf("min_heap,%.2f,%llu\n", min_heap * 1e9, (unsigned long long) checksums[1]);
+    printf("max_heap_negated,%.2f,%llu\n", max_heap * 1e9, (unsigned long long) checksums[2]);
+
+    return (checksums[0] == checksums[1] && checksums[1] == checksums[2]) ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "functions.h"
+
+#define DEFAULT_DEPTH 20        // Each root task fans out into 2^depth leaves
+#define ROOT_TASKS 4            // Trees submitted from outside the pool
+#define LEAF_WORK 200           // Loop iterations per leaf, roughly a few hundred ns
+
+/*
+ * Fork-join workload: every task either submits two children or, at the bottom,
+ * does a little arithmetic. Almost every submission comes from a worker, which is
+ * the case a single shared queue serializes and per-worker deques do not
+ *
+ * The baseline pool below is the design tp_* replaces: one FIFO behind one mutex
+ */
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static _Atomic(uint64_t) checksum;
+
+static void leaf_work() {
+    uint64_t x = 0x9E3779B97F4A7C15ULL;
+
+    for (int i = 0; i < LEAF_WORK; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+
+    atomic_fetch_add_explicit(&checksum, x & 0xFF, memory_order_relaxed);
+}
+
+// Baseline: a shared FIFO of tasks guarded by one mutex
+
+typedef struct LockedTask {
+    size_t depth;
+    struct LockedTask *next;
+} LockedTask;
+
+typedef struct LockedPool {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    pthread_cond_t done;
+    LockedTask *head;
+    LockedTask *tail;
+    size_t pending;
+    int shutdown;
+} LockedPool;
+
+static void locked_submit(LockedPool *pool, size_t depth) {
+    LockedTask *task = malloc(sizeof(LockedTask));
+    task->depth = depth;
+    task->next = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail) {
+        pool->tail->next = task;
+    } else {
+        pool->head = task;
+    }
+    pool->tail = task;
+    pool->pending++;
+    pthread_cond_signal(&pool->ready);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void *locked_worker(void *arg) {
+    LockedPool *pool = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->head && !pool->shutdown) {
+            pthread_cond_wait(&pool->ready, &pool->lock);
+        }
+        if (!pool->head) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        LockedTask *task = pool->head;
+        pool->head = task->next;
+        if (!pool->head) {
+            pool->tail = NULL;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        if (task->depth == 0) {
+            leaf_work();
+        } else {
+            locked_submit(pool, task->depth - 1);
+            locked_submit(pool, task->depth - 1);
+        }
+        free(task);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            pthread_cond_broadcast(&pool->done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static double run_locked(size_t threads, size_t depth) {
+    LockedPool pool = {.head = NULL, .tail = NULL, .pending = 0, .shutdown = 0};
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.ready, NULL);
+    pthread_cond_init(&pool.done, NULL);
+
+    for (size_t i = 0; i < threads; i++) {
+        pthread_create(&workers[i], NULL, locked_worker, &pool);
+    }
+
+    double start = now_seconds();
+
+    for (int i = 0; i < ROOT_TASKS; i++) {
+        locked_submit(&pool, depth);
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.pending > 0) {
+        pthread_cond_wait(&pool.done, &pool.lock);
+    }
+    pool.shutdown = 1;
+    pthread_cond_broadcast(&pool.ready);
+    pthread_mutex_unlock(&pool.lock);
+
+    double elapsed = now_seconds() - start;
+
+    for (size_t i = 0; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool.lock);
+    pthread_cond_destroy(&pool.ready);
+    pthread_cond_destroy(&pool.done);
+    free(workers);
+
+    return elapsed;
+}
+
+// Work-stealing pool from the library
+
+static ThreadPool *stealing_pool;
+
+static void stealing_task(void *arg) {
+    size_t depth = (size_t) (uintptr_t) arg;
+
+    if (depth == 0) {
+        leaf_work();
+    } else {
+        tp_submit(stealing_pool, stealing_task, (void *) (uintptr_t) (depth - 1));
+        tp_submit(stealing_pool, stealing_task, (void *) (uintptr_t) (depth - 1));
+    }
+}
+
+static double run_stealing(size_t threads, size_t depth) {
+    stealing_pool = tp_create(threads);
+
+    double start = now_seconds();
+
+    for (int i = 0; i < ROOT_TASKS; i++) {
+        tp_submit(stealing_pool, stealing_task, (void *) (uintptr_t) depth);
+    }
+    tp_wait(stealing_pool);
+
+    double elapsed = now_seconds() - start;
+
+    tp_free(stealing_pool);
+
+    return elapsed;
+}
+
+int main(int argc, char **argv) {
+    size_t depth = DEFAULT_DEPTH;
+
+    if (argc > 1) {
+        depth = strtoull(argv[1], NULL, 10);
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_threads = cpus > 0 ? (size_t) cpus : 1;
+    double tasks = (double) ROOT_TASKS * (double) ((2ULL << depth) - 1);
+
+    printf("tasks,%.0f\n", tasks);
+    printf("pool,threads,seconds,ns_per_task,checksum\n");
+
+    // Powers of two up to the CPU count, then the CPU count itself
+    for (size_t threads = 1;; threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+        atomic_store(&checksum, 0);
+        double seconds = run_locked(threads, depth);
+        printf("locked_queue,%zu,%.4f,%.1f,%llu\n", threads, seconds, seconds * 1e9 / tasks,
+               (unsigned long long) atomic_load(&checksum));
+
+        atomic_store(&checksum, 0);
+        seconds = run_stealing(threads, depth);
+        printf("work_stealing,%zu,%.4f,%.1f,%llu\n", threads, seconds, seconds * 1e9 / tasks,
+               (unsigned long long) atomic_load(&checksum));
+
+        if (threads == max_threads) {
+            break;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,160 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "functions.h"
+
+#define MAX_DELAY (1 << 20)     // Timeouts are spread over 2^20 ticks, about 17 minutes of 1 ms ticks
+#define STEP_TICKS 16           // Ticks the clock advances between expiry checks
+#define CANCEL_EVERY 10         // Every tenth timer is cancelled, as when a connection closes early
+
+/*
+ * Connection-timeout workload: schedule n timers with random delays, cancel some,
+ * then move the clock forward in small steps and collect whatever has expired.
+ * Heap holds negated deadlines so h_pop_max yields the earliest one; it cannot
+ * cancel, so its run expires every timer instead
+ *
+ * Both structures are filled and drained once before timing, as in a long-running
+ * server whose timer storage is already grown; the heap's shrinking is disabled
+ */
+
+static const size_t default_sizes[] = {1000000, 10000000};
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static void run_heap(const uint64_t *delays, size_t n) {
+    GrowthPolicy policy = {.initial_capacity = n, .growth_factor = 2.0, .shrink_threshold = 0.0};
+    Heap *h = h_create_with_policy(&policy, NULL);
+    double checksum = 0.0;
+
+    if (!h) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        h_insert(h, -(double) delays[i]);
+    }
+    while (h_size(h) > 0) {
+        h_pop_max(h);
+    }
+
+    double start = now_seconds();
+    for (size_t i = 0; i < n; i++) {
+        h_insert(h, -(double) delays[i]);
+    }
+    double schedule = now_seconds() - start;
+
+    start = now_seconds();
+    for (uint64_t now = 0; h_size(h) > 0; now += STEP_TICKS) {
+        while (h_size(h) > 0 && -h_peek(h) <= (double) now) {
+            checksum += h_pop_max(h);
+        }
+    }
+    double expire = now_seconds() - start;
+
+    printf("heap,%zu,%.1f,,%.1f,%.0f\n", n, schedule * 1e9 / n, expire * 1e9 / n, -checksum);
+    h_free(h);
+}
+
+static void run_wheel(const uint64_t *delays, size_t n) {
+    TimingWheel *tw = tw_create();
+    TimerHandle *handles = malloc(n * sizeof(TimerHandle));
+    double checksum = 0.0;
+    size_t cancelled = 0;
+
+    if (!tw || !handles) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        handles[i] = tw_schedule(tw, delays[i], 0.0);
+    }
+    for (size_t i = 0; i < n; i++) {
+        tw_cancel(tw, handles[i]);
+    }
+
+    double start = now_seconds();
+    for (size_t i = 0; i < n; i++) {
+        handles[i] = tw_schedule(tw, delays[i], (double) delays[i]);
+    }
+    double schedule = now_seconds() - start;
+
+    start = now_seconds();
+    for (size_t i = 0; i < n; i += CANCEL_EVERY) {
+        cancelled += tw_cancel(tw, handles[i]) == 0;
+    }
+    double cancel = now_seconds() - start;
+
+    size_t expired = 0;
+    start = now_seconds();
+    while (tw_size(tw) > 0) {
+        tw_advance(tw, STEP_TICKS);
+
+        double value;
+        while (!isnan(value = tw_pop_expired(tw, NULL))) {
+            checksum += value;
+            expired++;
+        }
+    }
+    double expire = now_seconds() - start;
+
+    printf("timing_wheel,%zu,%.1f,%.1f,%.1f,%.0f\n", n, schedule * 1e9 / n, cancel * 1e9 / cancelled,
+           expire * 1e9 / expired, checksum);
+    free(handles);
+    tw_free(tw);
+}
+
+int main(int argc, char **argv) {
+    size_t sizes[8];
+    size_t count = 0;
+
+    for (int i = 1; i < argc && count < 8; i++) {
+        sizes[count++] = strtoull(argv[i], NULL, 10);
+    }
+    if (count == 0) {
+        for (size_t i = 0; i < sizeof(default_sizes) / sizeof(default_sizes[0]); i++) {
+            sizes[count++] = default_sizes[i];
+        }
+    }
+
+    printf("structure,timers,schedule_ns,cancel_ns,expire_ns,checksum\n");
+
+    for (size_t s = 0; s < count; s++) {
+        size_t n = sizes[s];
+        uint64_t *delays = malloc(n * sizeof(uint64_t));
+
+        if (!delays) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            delays[i] = 1 + next_random() % MAX_DELAY;
+        }
+
+        run_heap(delays, n);
+        run_wheel(delays, n);
+        free(delays);
+    }
+
+    return 0;
+}
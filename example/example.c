@@ -1,6 +1,19 @@
 #include <stdio.h>
 
 #include "functions.h"
+#include "typed_containers.h"
+
+// A typed heap of tasks, ordered by priority, stored by value
+typedef struct Task {
+    int priority;
+    const char *name;
+} Task;
+
+static inline int task_less(const Task *a, const Task *b) {
+    return a->priority < b->priority;
+}
+
+DEFINE_HEAP(task, Task, task_less)
 
 int main() {
     printf("----------Stack outputs----------\n");
@@ -89,5 +102,95 @@ int main() {
 
     h_free(h);
     h = NULL;
+
+    printf("----------Min-max heap outputs----------\n");
+    MinMaxHeap *mmh = mmh_create();
+
+    mmh_insert(mmh, 310.5);
+    mmh_insert(mmh, 72.25);
+    mmh_insert(mmh, 958.75);
+    mmh_insert(mmh, 403.0);
+
+    printf("%.2f\n", mmh_pop_min(mmh));
+    printf("%.2f\n", mmh_pop_max(mmh));
+
+    printf("%.2f %.2f\n", mmh_peek_min(mmh), mmh_peek_max(mmh));
+
+    mmh_free(mmh);
+    mmh = NULL;
+
+    printf("----------Indexed heap outputs----------\n");
+    IndexedHeap *ih = ih_create();
+
+    size_t first = ih_insert(ih, 12.5);
+    size_t second = ih_insert(ih, 88.25);
+    ih_insert(ih, 47.75);
+
+    ih_update_key(ih, first, 99.0);
+    ih_remove(ih, second);
+
+    size_t top;
+    printf("%.2f\n", ih_pop_max(ih, &top));
+    printf("%zu\n", top);
+
+    printf("%.2f\n", ih_peek(ih));
+
+    ih_free(ih);
+    ih = NULL;
+
+    printf("----------Pairing heap outputs----------\n");
+    PairingHeap *ph = ph_create();
+    PairingHeap *other = ph_create();
+
+    ph_insert(ph, 215.5);
+    ph_insert(ph, 631.25);
+    ph_insert(other, 877.0);
+    ph_insert(other, 104.75);
+
+    ph_meld(ph, other);
+
+    printf("%.2f\n", ph_pop_max(ph));
+    printf("%.2f\n", ph_peek(ph));
+    printf("%zu\n", ph_size(ph));
+
+    ph_free(other);
+    other = NULL;
+    ph_free(ph);
+    ph = NULL;
+
+    printf("----------Typed heap outputs----------\n");
+    Heap_task *tasks = h_task_create();
+
+    h_task_insert(tasks, (Task) {3, "flush logs"});
+    h_task_insert(tasks, (Task) {9, "serve request"});
+    h_task_insert(tasks, (Task) {5, "compact index"});
+
+    Task task;
+    while (h_task_pop(tasks, &task) == 0) {
+        printf("%d %s\n", task.priority, task.name);
+    }
+
+    h_task_free(tasks);
+    tasks = NULL;
+
+    printf("----------B+tree outputs----------\n");
+    BTree *bt = bt_create();
+
+    for (int i = 0; i < 100; i++) {
+        bt_insert(bt, i * 1.5, i);
+    }
+
+    bt_delete(bt, 30.0);
+    printf("%.2f\n", bt_search(bt, 45.0));
+
+    BTreeIterator it;
+    double key, value;
+    bt_range(bt, 27.0, 34.0, &it);
+    while (bt_next(&it, &key, &value)) {
+        printf("%.2f -> %.2f\n", key, value);
+    }
+
+    bt_free(bt);
+    bt = NULL;
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <stddef.h>
+
+/*
+ * Memory callbacks used by the *_create_with_allocator functions
+ * Every call receives the context pointer, and realloc/free also receive the
+ * size of the block so backends do not need per-block headers
+ */
+typedef struct Allocator {
+    void *(*alloc)(void *context, size_t size);
+    void *(*realloc)(void *context, void *ptr, size_t old_size, size_t new_size);
+    void (*free)(void *context, void *ptr, size_t size);
+    void *context;
+} Allocator;
+
+typedef struct Arena Arena;
+
+// Convenience wrappers so call sites read like malloc/realloc/free
+static inline void *allocator_alloc(const Allocator *a, size_t size) {
+    return a->alloc(a->context, size);
+}
+
+static inline void *allocator_realloc(const Allocator *a, void *ptr, size_t old_size, size_t new_size) {
+    return a->realloc(a->context, ptr, old_size, new_size);
+}
+
+static inline void allocator_free(const Allocator *a, void *ptr, size_t size) {
+    if (ptr) {
+        a->free(a->context, ptr, size);
+    }
+}
+
+// The malloc/realloc/free backend used when no allocator is given
+const Allocator *allocator_default();
+
+// Bump arena: frees are no-ops (except for the latest block) and arena_reset releases everything at once
+Arena *arena_create(size_t block_size);
+int arena_free(Arena *arena);
+void arena_reset(Arena *arena);
+size_t arena_used(Arena *arena);
+Allocator arena_allocator(Arena *arena);
+
+// Thread-local size-class pool: small blocks are recycled per thread without locking
+const Allocator *pool_allocator();
+
+// Large blocks are huge-page-advised mappings that grow with mremap instead of copying
+const Allocator *mmap_allocator();
+
+#endif
@@ -1,31 +1,113 @@
 #ifndef FUNCTIONS_H
 #define FUNCTIONS_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "allocator.h"
+#include "stats.h"
+
 // Definitions for each data structure
 typedef struct Stack Stack;
 typedef struct Queue Queue;
 typedef struct LinkedList LinkedList;
 typedef struct HashTable HashTable;
+typedef struct HashTableSnapshot HashTableSnapshot;
+typedef struct BloomFilter BloomFilter;
 typedef struct Heap Heap;
+typedef struct MinHeap MinHeap;
+typedef struct MinMaxHeap MinMaxHeap;
+typedef struct IndexedHeap IndexedHeap;
+typedef struct PairingHeap PairingHeap;
+typedef struct MultiQueue MultiQueue;
+typedef struct RadixHeap RadixHeap;
+typedef struct BTree BTree;
+typedef struct Cache Cache;
+typedef struct WsDeque WsDeque;
+typedef struct ThreadPool ThreadPool;
+typedef struct TimingWheel TimingWheel;
+
+// Returned by ih_insert/ih_peek_handle when no handle is available
+#define IH_INVALID_HANDLE ((size_t) -1)
+
+// Returned by s_find when no element matches
+#define S_NOT_FOUND ((size_t) -1)
+
+// Identifies a scheduled timer; stale handles are rejected rather than reaching a reused timer
+typedef uint64_t TimerHandle;
+
+// Returned by tw_schedule when no handle is available
+#define TW_INVALID_HANDLE ((TimerHandle) -1)
+
+/*
+ * Sizing rules for the arrays behind Stack, Queue, Heap and MinHeap
+ * Zero fields take the defaults (100 elements, factor 2, never shrink)
+ */
+typedef struct GrowthPolicy {
+    size_t initial_capacity;    // Starting capacity, also the floor for shrinking
+    double growth_factor;       // Capacity multiplier when full, must be > 1
+    double shrink_threshold;    // Shrink by growth_factor once size < capacity * threshold; 0 disables
+} GrowthPolicy;
+
+// Cursor over a B+tree key range, filled in by bt_range; invalid once the tree is modified
+typedef struct BTreeIterator {
+    const void *leaf;   // Leaf holding the next pair, NULL once exhausted
+    size_t index;       // Position of the next pair within that leaf
+    double high;        // Inclusive upper bound of the range
+} BTreeIterator;
+
+// How a full Cache picks its victim
+typedef enum CachePolicy {
+    CACHE_LRU,      // Evict the least recently used entry; every hit relinks its entry
+    CACHE_CLOCK     // Second chance: a hit only sets a bit, eviction sweeps a clock hand
+} CachePolicy;
+
+// Counters kept by every Cache
+typedef struct CacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} CacheStats;
+
+// Aggregate computed by s_reduce/q_reduce
+typedef enum ReduceOp {
+    REDUCE_SUM,
+    REDUCE_MIN,
+    REDUCE_MAX
+} ReduceOp;
 
 // Stack operations
 Stack *s_create();
+Stack *s_create_with_allocator(const Allocator *allocator);
+Stack *s_create_with_policy(const GrowthPolicy *policy, const Allocator *allocator);
 int s_free(Stack *s);
 int s_push(Stack *s, double value);
 double s_pop(Stack *s);
 double s_peek(Stack *s);
 int s_print(Stack *s);
+double s_reduce(Stack *s, ReduceOp op);
+size_t s_find(Stack *s, double value);
+int s_stats(Stack *s, DsStats *out);
+int s_write(Stack *s, int fd);
+Stack *s_read(int fd);
 
 // Queue operations
 Queue *q_create();
+Queue *q_create_with_allocator(const Allocator *allocator);
+Queue *q_create_with_policy(const GrowthPolicy *policy, const Allocator *allocator);
 int q_free(Queue *q);
 int q_enqueue(Queue *q, double value);
 double q_dequeue(Queue *q);
 double q_peek(Queue *q);
 int q_print(Queue *q);
+double q_reduce(Queue *q, ReduceOp op);
+int q_stats(Queue *q, DsStats *out);
+int q_write(Queue *q, int fd);
+Queue *q_read(int fd);
 
 // Linked list operations
 LinkedList *ll_create();
+LinkedList *ll_create_with_allocator(const Allocator *allocator);
 int ll_free(LinkedList *ll);
 int ll_insert_head(LinkedList *ll, double value);
 int ll_insert_tail(LinkedList *ll, double value);
@@ -34,20 +116,157 @@ int ll_remove_head(LinkedList *ll);
 int ll_remove_tail(LinkedList *ll);
 int ll_remove_at(LinkedList *ll,size_t index);
 void ll_print(LinkedList *ll);
+int ll_stats(LinkedList *ll, DsStats *out);
+int ll_write(LinkedList *ll, int fd);
+LinkedList *ll_read(int fd);
 
 // Hash table operations
 HashTable *ht_create();
+HashTable *ht_create_with_allocator(const Allocator *allocator);
 int ht_free(HashTable *ht);
 void ht_insert(HashTable *ht, char *key, double value);
 int ht_delete(HashTable *ht, char *key);
 double ht_search(HashTable *ht, char *key);
 void ht_print(HashTable *ht);
+unsigned int ht_hash(char *key);
+int ht_attach_filter(HashTable *ht, double false_positive_rate);
+int ht_detach_filter(HashTable *ht);
+int ht_stats(HashTable *ht, DsStats *out);
+HashTableSnapshot *ht_snapshot(HashTable *ht);
+double hts_search(HashTableSnapshot *snapshot, char *key);
+size_t hts_size(HashTableSnapshot *snapshot);
+int hts_free(HashTableSnapshot *snapshot);
+int ht_rehash_parallel(HashTable *ht, ThreadPool *pool);
+HashTable *ht_build_parallel(char **keys, const double *values, size_t count, ThreadPool *pool);
 
 // Heap operations
 Heap *h_create();
+Heap *h_create_with_allocator(const Allocator *allocator);
+Heap *h_create_with_policy(const GrowthPolicy *policy, const Allocator *allocator);
 int h_free(Heap *h);
 void h_insert(Heap *h, double value);
 double h_peek(Heap *h);
 double h_pop_max(Heap *h);
+size_t h_size(Heap *h);
+size_t h_count_above(Heap *h, double threshold);
+Heap *h_build_from_array(const double *values, size_t count, ThreadPool *pool);
+int h_sort_parallel(double *values, size_t count, ThreadPool *pool);
+int h_stats(Heap *h, DsStats *out);
+int h_write(Heap *h, int fd);
+Heap *h_read(int fd);
+
+// Min-heap operations
+MinHeap *mh_create();
+MinHeap *mh_create_with_allocator(const Allocator *allocator);
+MinHeap *mh_create_with_policy(const GrowthPolicy *policy, const Allocator *allocator);
+int mh_free(MinHeap *mh);
+void mh_insert(MinHeap *mh, double value);
+double mh_peek(MinHeap *mh);
+double mh_pop_min(MinHeap *mh);
+int mh_stats(MinHeap *mh, DsStats *out);
+int mh_write(MinHeap *mh, int fd);
+MinHeap *mh_read(int fd);
+
+// Min-max heap operations
+MinMaxHeap *mmh_create();
+int mmh_free(MinMaxHeap *mmh);
+void mmh_insert(MinMaxHeap *mmh, double value);
+double mmh_peek_min(MinMaxHeap *mmh);
+double mmh_peek_max(MinMaxHeap *mmh);
+double mmh_pop_min(MinMaxHeap *mmh);
+double mmh_pop_max(MinMaxHeap *mmh);
+size_t mmh_size(MinMaxHeap *mmh);
+
+// Indexed heap operations
+IndexedHeap *ih_create();
+int ih_free(IndexedHeap *ih);
+size_t ih_insert(IndexedHeap *ih, double priority);
+int ih_update_key(IndexedHeap *ih, size_t handle, double priority);
+int ih_remove(IndexedHeap *ih, size_t handle);
+int ih_contains(IndexedHeap *ih, size_t handle);
+double ih_get(IndexedHeap *ih, size_t handle);
+double ih_peek(IndexedHeap *ih);
+size_t ih_peek_handle(IndexedHeap *ih);
+double ih_pop_max(IndexedHeap *ih, size_t *handle);
+size_t ih_size(IndexedHeap *ih);
+
+// Pairing heap operations
+PairingHeap *ph_create();
+int ph_free(PairingHeap *ph);
+void ph_insert(PairingHeap *ph, double value);
+double ph_peek(PairingHeap *ph);
+double ph_pop_max(PairingHeap *ph);
+int ph_meld(PairingHeap *dst, PairingHeap *src);
+size_t ph_size(PairingHeap *ph);
+
+// Radix heap operations (monotone min-heap, keys must not go below the last popped key)
+RadixHeap *rh_create();
+int rh_free(RadixHeap *rh);
+int rh_insert(RadixHeap *rh, uint64_t key, double value);
+double rh_peek(RadixHeap *rh, uint64_t *key);
+double rh_pop_min(RadixHeap *rh, uint64_t *key);
+size_t rh_size(RadixHeap *rh);
+
+// Concurrent multi-queue operations (thread-safe, relaxed ordering)
+MultiQueue *mq_create(size_t num_heaps);
+int mq_free(MultiQueue *mq);
+int mq_insert(MultiQueue *mq, double value);
+double mq_pop_max(MultiQueue *mq);
+size_t mq_size(MultiQueue *mq);
+
+// B+tree ordered map operations
+BTree *bt_create();
+BTree *bt_build_sorted(const double *keys, const double *values, size_t n);
+int bt_free(BTree *bt);
+int bt_insert(BTree *bt, double key, double value);
+double bt_search(BTree *bt, double key);
+int bt_delete(BTree *bt, double key);
+size_t bt_size(BTree *bt);
+int bt_range(BTree *bt, double low, double high, BTreeIterator *it);
+int bt_next(BTreeIterator *it, double *key, double *value);
+
+// Bounded cache operations (string keys, O(1) get/put/evict)
+Cache *cache_create(size_t capacity, CachePolicy policy);
+int cache_free(Cache *c);
+int cache_put(Cache *c, char *key, double value);
+double cache_get(Cache *c, char *key);
+int cache_delete(Cache *c, char *key);
+size_t cache_size(Cache *c);
+int cache_stats(Cache *c, CacheStats *out);
+
+// Blocked Bloom filter operations (one cache line per query, no false negatives)
+BloomFilter *bf_create(size_t expected_keys, double false_positive_rate);
+int bf_free(BloomFilter *bf);
+void bf_clear(BloomFilter *bf);
+void bf_add(BloomFilter *bf, char *key);
+int bf_contains(BloomFilter *bf, char *key);
+void bf_add_hash(BloomFilter *bf, uint64_t hash);
+int bf_contains_hash(BloomFilter *bf, uint64_t hash);
+size_t bf_memory(BloomFilter *bf);
+
+// Work-stealing deque operations (owner pushes and pops at the bottom, any thread steals from the top)
+WsDeque *wsd_create(size_t capacity);
+int wsd_free(WsDeque *d);
+int wsd_push(WsDeque *d, void *item);
+void *wsd_pop(WsDeque *d);
+void *wsd_steal(WsDeque *d);
+size_t wsd_size(WsDeque *d);
+
+// Thread pool operations (one work-stealing deque per worker)
+ThreadPool *tp_create(size_t num_threads);
+int tp_free(ThreadPool *pool);
+int tp_submit(ThreadPool *pool, void (*function)(void *arg), void *arg);
+int tp_wait(ThreadPool *pool);
+size_t tp_size(ThreadPool *pool);
+
+// Timing wheel operations (O(1) schedule, cancel and expiry per tick)
+TimingWheel *tw_create();
+int tw_free(TimingWheel *tw);
+TimerHandle tw_schedule(TimingWheel *tw, uint64_t delay, double value);
+int tw_cancel(TimingWheel *tw, TimerHandle handle);
+size_t tw_advance(TimingWheel *tw, uint64_t ticks);
+double tw_pop_expired(TimingWheel *tw, TimerHandle *handle);
+uint64_t tw_now(TimingWheel *tw);
+size_t tw_size(TimingWheel *tw);
 
 #endif
@@ -0,0 +1,44 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define STATS_LATENCY_BUCKETS 32    // Bucket i counts sampled calls that took [2^i, 2^(i+1)) ns
+
+/*
+ * Per-instance counters, filled in only when the library is built with LDS_STATS
+ * (CMake option LDS_ENABLE_STATS); otherwise the counting code compiles to nothing
+ * and every *_stats function returns -1
+ */
+typedef struct DsStats {
+    uint64_t operations;    // Every insert, remove and lookup call
+    uint64_t inserts;       // Push, enqueue and insert calls that stored an element
+    uint64_t removals;      // Pop, dequeue, remove and delete calls that removed an element
+    uint64_t lookups;       // Peek and search calls
+    uint64_t resizes;       // Array growths and hash table rehashes
+    uint64_t bytes_moved;   // Bytes copied or relinked by those resizes
+    uint64_t probes;        // Chain entries compared (hash table) or nodes walked (linked list)
+    uint64_t max_probe;     // Longest single chain comparison or list walk
+    size_t size;            // Current number of elements
+    size_t peak_size;       // Largest number of elements ever held
+    uint64_t latency_samples;                       // Calls timed for the histogram
+    uint64_t latency_ns[STATS_LATENCY_BUCKETS];     // Log2 histogram of sampled call latency
+} DsStats;
+
+// Why a hook was called
+typedef enum DsStatsEvent {
+    STATS_EVENT_RESIZE,     // An instance just grew its array or rehashed
+    STATS_EVENT_FREE        // An instance is about to be freed; these are its final counters
+} DsStatsEvent;
+
+typedef void (*DsStatsHook)(const char *structure, const void *instance, DsStatsEvent event,
+                            const DsStats *stats, void *context);
+
+// Installs a process-wide hook (NULL removes it); set it before other threads use the library
+void stats_set_hook(DsStatsHook hook, void *context);
+
+// Times one call in every 'every' per thread for the latency histogram (0, the default, turns sampling off)
+void stats_set_sample_rate(unsigned every);
+
+#endif
@@ -0,0 +1,862 @@
+#ifndef TYPED_CONTAINERS_H
+#define TYPED_CONTAINERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "allocator.h"
+
+/*
+ * Type-generic containers generated by macros
+ *
+ * Each DEFINE_* macro expands to a struct and a set of static inline functions
+ * for one element type, so elements are stored by value and the comparison and
+ * hash functions are inlined instead of being called through pointers:
+ *
+ *   DEFINE_STACK(i32, int32_t)              -> Stack_i32,   s_i32_push, s_i32_pop, ...
+ *   DEFINE_QUEUE(ev, Event)                 -> Queue_ev,    q_ev_enqueue, q_ev_dequeue, ...
+ *   DEFINE_HEAP(task, Task, task_less)      -> Heap_task,   h_task_insert, h_task_pop, ...
+ *   DEFINE_HASHMAP(u64, MyStruct)           -> HashMap_u64, ht_u64_insert, ht_u64_search, ...
+ *
+ * Instead of returning NAN when empty, functions return 0 on success and -1 on
+ * failure, and values come back through output pointers
+ *
+ * DEFINE_FIXED_* variants below take a compile-time capacity and never allocate
+ */
+
+#define TYPED_DEFAULT_CAPACITY 128  // Starting capacity; a power of two so indices can be masked
+#define TYPED_MAX_LOAD 0.7          // Hash maps grow when occupied slots exceed this fraction
+
+/* ---------- Stack ---------- */
+
+#define DEFINE_STACK(name, T)                                                               \
+    typedef struct Stack_##name {                                                           \
+        T *data;                                                                            \
+        size_t top;                                                                         \
+        size_t capacity;                                                                    \
+        Allocator allocator;                                                                \
+    } Stack_##name;                                                                         \
+                                                                                            \
+    static inline Stack_##name *s_##name##_create_with_allocator(const Allocator *allocator) { \
+        if (!allocator) {                                                                   \
+            allocator = allocator_default();                                                \
+        }                                                                                   \
+        Stack_##name *s = allocator_alloc(allocator, sizeof(Stack_##name));                 \
+        if (!s) {                                                                           \
+            return NULL;                                                                    \
+        }                                                                                   \
+        s->data = allocator_alloc(allocator, TYPED_DEFAULT_CAPACITY * sizeof(T));           \
+        if (!s->data) {                                                                     \
+            allocator_free(allocator, s, sizeof(Stack_##name));                             \
+            return NULL;                                                                    \
+        }                                                                                   \
+        s->top = 0;                                                                         \
+        s->capacity = TYPED_DEFAULT_CAPACITY;                                               \
+        s->allocator = *allocator;                                                          \
+        return s;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline Stack_##name *s_##name##_create(void) {                                   \
+        return s_##name##_create_with_allocator(NULL);                                      \
+    }                                                                                       \
+                                                                                            \
+    static inline int s_##name##_free(Stack_##name *s) {                                    \
+        if (!s) {                                                                           \
+            return -1;                                                                      \
+        }                                                                                   \
+        Allocator allocator = s->allocator;                                                 \
+        allocator_free(&allocator, s->data, s->capacity * sizeof(T));                       \
+        allocator_free(&allocator, s, sizeof(Stack_##name));                                \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline int s_##name##_push(Stack_##name *s, T value) {                           \
+        if (!s) {                                                                           \
+            return -1;                                                                      \
+        }                                                                                   \
+        if (s->top >= s->capacity) {                                                        \
+            T *buffer = allocator_realloc(&s->allocator, s->data, s->capacity * sizeof(T),  \
+                                          s->capacity * 2 * sizeof(T));                     \
+            if (!buffer) {                                                                  \
+                return -1;                                                                  \
+            }                                                                               \
+            s->data = buffer;                                                               \
+            s->capacity *= 2;                                                               \
+        }                                                                                   \
+        s->data[s->top++] = value;                                                          \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline int s_##name##_pop(Stack_##name *s, T *out) {                             \
+        if (!s || s->top == 0) {                                                            \
+            return -1;                                                                      \
+        }                                                                                   \
+        s->top--;                                                                           \
+        if (out) {                                                                          \
+            *out = s->data[s->top];                                                         \
+        }                                                                                   \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline int s_##name##_peek(const Stack_##name *s, T *out) {                      \
+        if (!s || s->top == 0) {                                                            \
+            return -1;                                                                      \
+        }                                                                                   \
+        *out = s->data[s->top - 1];                                                         \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline size_t s_##name##_size(const Stack_##name *s) {                           \
+        return s ? s->top : 0;                                                              \
+    }
+
+/* ---------- Queue ---------- */
+
+// Circular queue with a power-of-two capacity, so wrapping is a mask instead of a modulo
+#define DEFINE_QUEUE(name, T)                                                               \
+    typedef struct Queue_##name {                                                           \
+        T *data;                                                                            \
+        size_t head;                                                                        \
+        size_t size;                                                                        \
+        size_t capacity;                                                                    \
+        Allocator allocator;                                                                \
+    } Queue_##name;                                                                         \
+                                                                                            \
+    static inline Queue_##name *q_##name##_create_with_allocator(const Allocator *allocator) { \
+        if (!allocator) {                                                                   \
+            allocator = allocator_default();                                                \
+        }                                                                                   \
+        Queue_##name *q = allocator_alloc(allocator, sizeof(Queue_##name));                 \
+        if (!q) {                                                                           \
+            return NULL;                                                                    \
+        }                                                                                   \
+        q->data = allocator_alloc(allocator, TYPED_DEFAULT_CAPACITY * sizeof(T));           \
+        if (!q->data) {                                                                     \
+            allocator_free(allocator, q, sizeof(Queue_##name));                             \
+            return NULL;                                                                    \
+        }                                                                                   \
+        q->head = 0;                                                                        \
+        q->size = 0;                                                                        \
+        q->capacity = TYPED_DEFAULT_CAPACITY;                                               \
+        q->allocator = *allocator;                                                          \
+        return q;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline Queue_##name *q_##name##_create(void) {                                   \
+        return q_##name##_create_with_allocator(NULL);                                      \
+    }                                                                                       \
+                                                                                            \
+    static inline int q_##name##_free(Queue_##name *q) {                                    \
+        if (!q) {                                                                           \
+            return -1;                                                                      \
+        }                                                                                   \
+        Allocator allocator = q->allocator;                                                 \
+        allocator_free(&allocator, q->data, q->capacity * sizeof(T));                       \
+        allocator_free(&allocator, q, sizeof(Queue_##name));                                \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline int q_##name##_enqueue(Queue_##name *q, T value) {                        \
+        if (!q) {                                                                           \
+            return -1;                                                                      \
+        }                                                                                   \
+        if (q->size == q->capacity) {                                                       \
+            /* Realign the two wrapped segments to the start of a buffer twice as large */  \
+            T *buffer = allocator_alloc(&q->allocator, q->capacity * 2 * sizeof(T));        \
+            if (!buffer) {                                                                  \
+                return -1;                                                                  \
+            }                                                                               \
+            size_t first = q->capacity - q->head;                                           \
+            memcpy(buffer, q->data + q->head, first * sizeof(T));                           \
+            memcpy(buffer + first, q->data, q->head * sizeof(T));                           \
+            allocator_free(&q->allocator, q->data, q->capacity * sizeof(T));                \
+            q->data = buffer;                                                               \
+            q->head = 0;                                                                    \
+            q->capacity *= 2;                                                               \
+        }                                                                                   \
+        q->data[(q->head + q->size) & (q->capacity - 1)] = value;                           \
+        q->size++;                                                                          \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline int q_##name##_dequeue(Queue_##name *q, T *out) {                         \
+        if (!q || q->size == 0) {                                                           \
+            return -1;                                                                      \
+        }                                                                                   \
+        if (out) {                                                                          \
+            *out = q->data[q->head];                                                        \
+        }                                                                                   \
+        q->head = (q->head + 1) & (q->capacity - 1);                                        \
+        q->size--;                                                                          \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline int q_##name##_peek(const Queue_##name *q, T *out) {                      \
+        if (!q || q->size == 0) {                                                           \
+            return -1;                                                                      \
+        }                                                                                   \
+        *out = q->data[q->head];                                                            \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline size_t q_##name##_size(const Queue_##name *q) {                           \
+        return q ? q->size : 0;                                                             \
+    }
+
+/* ---------- Heap ---------- */
+
+/*
+ * Binary heap ordered by less(const T *a, const T *b)
+ * Like Heap, the greatest element according to less() is on top; pass a
+ * "greater" function instead to get a min-heap
+ */
+#define DEFINE_HEAP(name, T, less)                                                          \
+    typedef struct Heap_##name {                                                            \
+        T *data;                                                                            \
+        size_t size;                                                                        \
+        size_t capacity;                                                                    \
+        Allocator allocator;                                                                \
+    } Heap_##name;                                                                          \
+                                                                                            \
+    static inline Heap_##name *h_##name##_create_with_allocator(const Allocator *allocator) { \
+        if (!allocator) {                                                                   \
+            allocator = allocator_default();                                                \
+        }                                                                                   \
+        Heap_##name *h = allocator_alloc(allocator, sizeof(Heap_##name));                   \
+        if (!h) {                                                                           \
+            return NULL;                                                                    \
+        }                                                                                   \
+        h->data = allocator_alloc(allocator, TYPED_DEFAULT_CAPACITY * sizeof(T));           \
+        if (!h->data) {                                                                     \
+            allocator_free(allocator, h, sizeof(Heap_##name));                              \
+            return NULL;                                                                    \
+        }                                                                                   \
+        h->size = 0;                                                                        \
+        h->capacity = TYPED_DEFAULT_CAPACITY;                                               \
+        h->allocator = *allocator;                                                          \
+        return h;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline Heap_##name *h_##name##_create(void) {                                    \
+        return h_##name##_create_with_allocator(NULL);                                      \
+    }                                                                                       \
+                                                                                            \
+    static inline int h_##name##_free(Heap_##name *h) {                                     \
+        if (!h) {                                                                           \
+            return -1;                                                                      \
+        }                                                                                   \
+        Allocator allocator = h->allocator;                                                 \
+        allocator_free(&allocator, h->data, h->capacity * sizeof(T));                       \
+        allocator_free(&allocator, h, sizeof(Heap_##name));                                 \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline int h_##name##_insert(Heap_##name *h, T value) {                          \
+        if (!h) {                                                                           \
+            return -1;                                                                      \
+        }                                                                                   \
+        if (h->size >= h->capacity) {                                                       \
+            T *buffer = allocator_realloc(&h->allocator, h->data, h->capacity * sizeof(T),  \
+                                          h->capacity * 2 * sizeof(T));                     \
+            if (!buffer) {                                                                  \
+                return -1;                                                                  \
+            }                                                                               \
+            h->data = buffer;                                                               \
+            h->capacity *= 2;                                                               \
+        }                                                                                   \
+        /* Move the hole up past every parent that ranks below the new value */            \
+        size_t i = h->size++;                                                               \
+        while (i > 0) {                                                                     \
+            size_t parent = (i - 1) / 2;                                                    \
+            if (!less(&h->data[parent], &value)) {                                          \
+                break;                                                                      \
+            }                                                                               \
+            h->data[i] = h->data[parent];                                                   \
+            i = parent;                                                                     \
+        }                                                                                   \
+        h->data[i] = value;                                                                 \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline int h_##name##_peek(const Heap_##name *h, T *out) {                       \
+        if (!h || h->size == 0) {                                                           \
+            return -1;                                                                      \
+        }                                                                                   \
+        *out = h->data[0];                                                                  \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline int h_##name##_pop(Heap_##name *h, T *out) {                              \
+        if (!h || h->size == 0) {                                                           \
+            return -1;                                                                      \
+        }                                                                                   \
+        if (out) {                                                                          \
+            *out = h->data[0];                                                              \
+        }                                                                                   \
+        T value = h->data[--h->size];                                                       \
+        size_t i = 0;                                                                       \
+        /* Move the hole down past every child that ranks above the last element */        \
+        while (2 * i + 1 < h->size) {                                                       \
+            size_t child = 2 * i + 1;                                                       \
+            if (child + 1 < h->size && less(&h->data[child], &h->data[child + 1])) {        \
+                child++;                                                                    \
+            }                                                                               \
+            if (!less(&value, &h->data[child])) {                                           \
+                break;                                                                      \
+            }                                                                               \
+            h->data[i] = h->data[child];                                                    \
+            i = child;                                                                      \
+        }                                                                                   \
+        if (h->size > 0) {                                                                  \
+            h->data[i] = value;                                                             \
+        }                                                                                   \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline size_t h_##name##_size(const Heap_##name *h) {                            \
+        return h ? h->size : 0;                                                             \
+    }
+
+/* ---------- Hash map ---------- */
+
+// Hash and equality helpers for the common key types
+static inline uint64_t typed_hash_u64(const uint64_t *key) {
+    // Finalizer from MurmurHash3, spreads every input bit across the word
+    uint64_t x = *key;
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline int typed_equal_u64(const uint64_t *a, const uint64_t *b) {
+    return *a == *b;
+}
+
+// For const char * keys; the strings themselves are not copied and must outlive the map
+static inline uint64_t typed_hash_string(const char *const *key) {
+    // FNV-1a
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (const unsigned char *c = (const unsigned char *) *key; *c; c++) {
+        hash = (hash ^ *c) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static inline int typed_equal_string(const char *const *a, const char *const *b) {
+    return strcmp(*a, *b) == 0;
+}
+
+#define TYPED_SLOT_EMPTY 0
+#define TYPED_SLOT_FULL 1
+#define TYPED_SLOT_DELETED 2
+
+/*
+ * Open-addressing hash map with linear probing
+ * hash(const K *) returns uint64_t and equal(const K *, const K *) returns non-zero for equal keys
+ * Keys and values are stored by value in one slot array; a separate state byte
+ * per slot marks it empty, full or deleted
+ */
+#define DEFINE_HASHMAP_KEYED(name, K, V, hash, equal)                                       \
+    typedef struct HashMapSlot_##name {                                                     \
+        K key;                                                                              \
+        V value;                                                                            \
+    } HashMapSlot_##name;                                                                   \
+                                                                                            \
+    typedef struct HashMap_##name {                                                         \
+        HashMapSlot_##name *slots;                                                          \
+        unsigned char *states;                                                              \
+        size_t count;       /* Live entries */                                              \
+        size_t used;        /* Live plus deleted slots, which both lengthen probes */       \
+        size_t capacity;    /* Always a power of two */                                     \
+        Allocator allocator;                                                                \
+    } HashMap_##name;                                                                       \
+                                                                                            \
+    static inline int ht_##name##_alloc_slots(HashMap_##name *map, size_t capacity) {       \
+        map->slots = allocator_alloc(&map->allocator, capacity * sizeof(HashMapSlot_##name)); \
+        map->states = allocator_alloc(&map->allocator, capacity);                           \
+        if (!map->slots || !map->states) {                                                  \
+            allocator_free(&map->allocator, map->slots, capacity * sizeof(HashMapSlot_##name)); \
+            allocator_free(&map->allocator, map->states, capacity);                         \
+            return -1;                                                                      \
+        }                                                                                   \
+        memset(map->states, TYPED_SLOT_EMPTY, capacity);                                    \
+        map->capacity = capacity;                                                           \
+        map->count = 0;                                                                     \
+        map->used = 0;                                                                      \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline HashMap_##name *ht_##name##_create_with_allocator(const Allocator *allocator) { \
+        if (!allocator) {                                                                   \
+            allocator = allocator_default();                                                \
+        }                                                                                   \
+        HashMap_##name *map = allocator_alloc(allocator, sizeof(HashMap_##name));           \
+        if (!map) {                                                                         \
+            return NULL;                                                                    \
+        }                                                                                   \
+        map->allocator = *allocator;                                                        \
+        if (ht_##name##_alloc_slots(map, TYPED_DEFAULT_CAPACITY) != 0) {                    \
+            allocator_free(allocator, map, sizeof(HashMap_##name));                         \
+            return NULL;                                                                    \
+        }                                                                                   \
+        return map;                                                                         \
+    }                                                                                       \
+                                                                                            \
+    static inline HashMap_##name *ht_##name##_create(void) {                                \
+        return ht_##name##_create_with_allocator(NULL);                                     \
+    }                                                                                       \
+                                                                                            \
+    static inline int ht_##name##_free(HashMap_##name *map) {                               \
+        if (!map) {                                                                         \
+            return -1;                                                                      \
+        }                                                                                   \
+        Allocator allocator = map->allocator;                                               \
+        allocator_free(&allocator, map->slots, map->capacity * sizeof(HashMapSlot_##name)); \
+        allocator_free(&allocator, map->states, map->capacity);                             \
+        allocator_free(&allocator, map, sizeof(HashMap_##name));                            \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    /* Returns the slot holding key, or the first reusable slot if it is absent */          \
+    static inline size_t ht_##name##_probe(const HashMap_##name *map, const K *key, int *found) { \
+        size_t mask = map->capacity - 1;                                                    \
+        size_t index = (size_t) hash(key) & mask;                                           \
+        size_t reusable = (size_t) -1;                                                      \
+        while (map->states[index] != TYPED_SLOT_EMPTY) {                                    \
+            if (map->states[index] == TYPED_SLOT_FULL) {                                    \
+                if (equal(&map->slots[index].key, key)) {                                   \
+                    *found = 1;                                                             \
+                    return index;                                                           \
+                }                                                                           \
+            }                                                                               \
+            else if (reusable == (size_t) -1) {                                             \
+                reusable = index;                                                           \
+            }                                                                               \
+            index = (index + 1) & mask;                                                     \
+        }                                                                                   \
+        *found = 0;                                                                         \
+        return reusable != (size_t) -1 ? reusable : index;                                  \
+    }                                                                                       \
+                                                                                            \
+    /* Moves every live entry into a fresh slot array, dropping deleted markers */          \
+    static inline int ht_##name##_rehash(HashMap_##name *map, size_t new_capacity) {        \
+        HashMap_##name old = *map;                                                          \
+        if (ht_##name##_alloc_slots(map, new_capacity) != 0) {                              \
+            *map = old;                                                                     \
+            return -1;                                                                      \
+        }                                                                                   \
+        for (size_t i = 0; i < old.capacity; i++) {                                         \
+            if (old.states[i] == TYPED_SLOT_FULL) {                                         \
+                int found;                                                                  \
+                size_t index = ht_##name##_probe(map, &old.slots[i].key, &found);           \
+                map->slots[index] = old.slots[i];                                           \
+                map->states[index] = TYPED_SLOT_FULL;                                       \
+                map->count++;                                                               \
+                map->used++;                                                                \
+            }                                                                               \
+        }                                                                                   \
+        allocator_free(&map->allocator, old.slots, old.capacity * sizeof(HashMapSlot_##name)); \
+        allocator_free(&map->allocator, old.states, old.capacity);                          \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    /* Inserts or updates a key; returns 0 on success and -1 if the map could not grow */   \
+    static inline int ht_##name##_insert(HashMap_##name *map, K key, V value) {             \
+        if (!map) {                                                                         \
+            return -1;                                                                      \
+        }                                                                                   \
+        if ((double) (map->used + 1) > (double) map->capacity * TYPED_MAX_LOAD) {           \
+            /* Only double when live entries need it; otherwise just purge deleted slots */ \
+            size_t target = (double) (map->count + 1) > (double) map->capacity * TYPED_MAX_LOAD / 2 \
+                ? map->capacity * 2 : map->capacity;                                        \
+            if (ht_##name##_rehash(map, target) != 0) {                                     \
+                return -1;                                                                  \
+            }                                                                               \
+        }                                                                                   \
+        int found;                                                                          \
+        size_t index = ht_##name##_probe(map, &key, &found);                                \
+        if (!found) {                                                                       \
+            if (map->states[index] == TYPED_SLOT_EMPTY) {                                   \
+                map->used++;                                                                \
+            }                                                                               \
+            map->states[index] = TYPED_SLOT_FULL;                                           \
+            map->slots[index].key = key;                                                    \
+            map->count++;                                                                   \
+        }                                                                                   \
+        map->slots[index].value = value;                                                    \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    /* Returns a pointer to the stored value, or NULL if the key is absent */              \
+    static inline V *ht_##name##_search(HashMap_##name *map, K key) {                       \
+        if (!map) {                                                                         \
+            return NULL;                                                                    \
+        }                                                                                   \
+        int found;                                                                          \
+        size_t index = ht_##name##_probe(map, &key, &found);                                \
+        return found ? &map->slots[index].value : NULL;                                     \
+    }                                                                                       \
+                                                                                            \
+    static inline int ht_##name##_delete(HashMap_##name *map, K key) {                      \
+        if (!map) {                                                                         \
+            return -1;                                                                      \
+        }                                                                                   \
+        int found;                                                                          \
+        size_t index = ht_##name##_probe(map, &key, &found);                                \
+        if (!found) {                                                                       \
+            return -1;                                                                      \
+        }                                                                                   \
+        map->states[index] = TYPED_SLOT_DELETED;                                            \
+        map->count--;                                                                       \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline size_t ht_##name##_size(const HashMap_##name *map) {                      \
+        return map ? map->count : 0;                                                        \
+    }                                                                                       \
+                                                                                            \
+    /*                                                                                      \
+     * Iterates over live entries: start with *cursor = 0 and call until it returns -1      \
+     * Inserting during iteration may rehash and invalidate the cursor                      \
+     */                                                                                     \
+    static inline int ht_##name##_next(HashMap_##name *map, size_t *cursor, K *key, V **value) { \
+        for (; map && *cursor < map->capacity; (*cursor)++) {                               \
+            if (map->states[*cursor] == TYPED_SLOT_FULL) {                                  \
+                if (key) {                                                                  \
+                    *key = map->slots[*cursor].key;                                         \
+                }                                                                           \
+                if (value) {                                                                \
+                    *value = &map->slots[*cursor].value;                                    \
+                }                                                                           \
+                (*cursor)++;                                                                \
+                return 0;                                                                   \
+            }                                                                               \
+        }                                                                                   \
+        return -1;                                                                          \
+    }
+
+// Hash map keyed by uint64_t
+#define DEFINE_HASHMAP(name, V) \
+    DEFINE_HASHMAP_KEYED(name, uint64_t, V, typed_hash_u64, typed_equal_u64)
+
+/* ---------- Fixed-capacity variants ---------- */
+
+/*
+ * Same containers with the capacity N fixed at compile time and the elements stored
+ * inside the struct, so an instance can live in static storage, on the stack or in
+ * caller-provided memory. Nothing ever allocates: _init() sets up an instance, there
+ * is no _free(), and adding to a full container returns -1 and leaves it unchanged.
+ * Every bound and index mask is a constant the compiler can fold, and no operation
+ * has an amortized slow path, so worst-case latency is fixed by N alone:
+ *
+ *   DEFINE_FIXED_STACK(i32, int32_t, 256)        -> FixedStack_i32,   fs_i32_push, ...
+ *   DEFINE_FIXED_QUEUE(ev, Event, 1024)          -> FixedQueue_ev,    fq_ev_enqueue, ...
+ *   DEFINE_FIXED_HEAP(task, Task, 64, task_less) -> FixedHeap_task,   fh_task_insert, ...
+ *   DEFINE_FIXED_HASHMAP(u64, MyStruct, 4096)    -> FixedHashMap_u64, fht_u64_insert, ...
+ *
+ * Queue and hash map capacities must be powers of two
+ */
+
+// Entries a fixed hash map of N slots accepts, keeping the load at TYPED_MAX_LOAD
+#define TYPED_FIXED_MAX_ENTRIES(N) ((size_t) ((double) (N) * TYPED_MAX_LOAD))
+
+#define DEFINE_FIXED_STACK(name, T, N)                                                      \
+    _Static_assert((N) > 0, "fixed stack capacity must be positive");                       \
+    typedef struct FixedStack_##name {                                                      \
+        T data[N];                                                                          \
+        size_t top;                                                                         \
+    } FixedStack_##name;                                                                    \
+                                                                                            \
+    static inline void fs_##name##_init(FixedStack_##name *s) {                             \
+        s->top = 0;                                                                         \
+    }                                                                                       \
+                                                                                            \
+    /* Returns -1 without touching the stack if all N slots are taken */                    \
+    static inline int fs_##name##_push(FixedStack_##name *s, T value) {                     \
+        if (!s || s->top >= (N)) {                                                          \
+            return -1;                                                                      \
+        }                                                                                   \
+        s->data[s->top++] = value;                                                          \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline int fs_##name##_pop(FixedStack_##name *s, T *out) {                       \
+        if (!s || s->top == 0) {                                                            \
+            return -1;                                                                      \
+        }                                                                                   \
+        s->top--;                                                                           \
+        if (out) {                                                                          \
+            *out = s->data[s->top];                                                         \
+        }                                                                                   \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline int fs_##name##_peek(const FixedStack_##name *s, T *out) {                \
+        if (!s || s->top == 0) {                                                            \
+            return -1;                                                                      \
+        }                                                                                   \
+        *out = s->data[s->top - 1];                                                         \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline size_t fs_##name##_size(const FixedStack_##name *s) {                     \
+        return s ? s->top : 0;                                                              \
+    }                                                                                       \
+                                                                                            \
+    static inline int fs_##name##_full(const FixedStack_##name *s) {                        \
+        return s && s->top >= (N);                                                          \
+    }
+
+// Circular queue; N is a power of two, so wrapping is a constant mask
+#define DEFINE_FIXED_QUEUE(name, T, N)                                                      \
+    _Static_assert((N) > 0 && ((N) & ((N) - 1)) == 0, "fixed queue capacity must be a power of two"); \
+    typedef struct FixedQueue_##name {                                                      \
+        T data[N];                                                                          \
+        size_t head;                                                                        \
+        size_t size;                                                                        \
+    } FixedQueue_##name;                                                                    \
+                                                                                            \
+    static inline void fq_##name##_init(FixedQueue_##name *q) {                             \
+        q->head = 0;                                                                        \
+        q->size = 0;                                                                        \
+    }                                                                                       \
+                                                                                            \
+    /* Returns -1 without touching the queue if all N slots are taken */                    \
+    static inline int fq_##name##_enqueue(FixedQueue_##name *q, T value) {                  \
+        if (!q || q->size >= (N)) {                                                         \
+            return -1;                                                                      \
+        }                                                                                   \
+        q->data[(q->head + q->size) & ((N) - 1)] = value;                                   \
+        q->size++;                                                                          \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline int fq_##name##_dequeue(FixedQueue_##name *q, T *out) {                   \
+        if (!q || q->size == 0) {                                                           \
+            return -1;                                                                      \
+        }                                                                                   \
+        if (out) {                                                                          \
+            *out = q->data[q->head];                                                        \
+        }                                                                                   \
+        q->head = (q->head + 1) & ((N) - 1);                                                \
+        q->size--;                                                                          \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline int fq_##name##_peek(const FixedQueue_##name *q, T *out) {                \
+        if (!q || q->size == 0) {                                                           \
+            return -1;                                                                      \
+        }                                                                                   \
+        *out = q->data[q->head];                                                            \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline size_t fq_##name##_size(const FixedQueue_##name *q) {                     \
+        return q ? q->size : 0;                                                             \
+    }                                                                                       \
+                                                                                            \
+    static inline int fq_##name##_full(const FixedQueue_##name *q) {                        \
+        return q && q->size >= (N);                                                         \
+    }
+
+// Binary heap ordered by less(), as in DEFINE_HEAP
+#define DEFINE_FIXED_HEAP(name, T, N, less)                                                 \
+    _Static_assert((N) > 0, "fixed heap capacity must be positive");                        \
+    typedef struct FixedHeap_##name {                                                       \
+        T data[N];                                                                          \
+        size_t size;                                                                        \
+    } FixedHeap_##name;                                                                     \
+                                                                                            \
+    static inline void fh_##name##_init(FixedHeap_##name *h) {                              \
+        h->size = 0;                                                                        \
+    }                                                                                       \
+                                                                                            \
+    /* Returns -1 without touching the heap if all N slots are taken */                     \
+    static inline int fh_##name##_insert(FixedHeap_##name *h, T value) {                    \
+        if (!h || h->size >= (N)) {                                                         \
+            return -1;                                                                      \
+        }                                                                                   \
+        /* Move the hole up past every parent that ranks below the new value */             \
+        size_t i = h->size++;                                                               \
+        while (i > 0) {                                                                     \
+            size_t parent = (i - 1) / 2;                                                    \
+            if (!less(&h->data[parent], &value)) {                                          \
+                break;                                                                      \
+            }                                                                               \
+            h->data[i] = h->data[parent];                                                   \
+            i = parent;                                                                     \
+        }                                                                                   \
+        h->data[i] = value;                                                                 \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline int fh_##name##_peek(const FixedHeap_##name *h, T *out) {                 \
+        if (!h || h->size == 0) {                                                           \
+            return -1;                                                                      \
+        }                                                                                   \
+        *out = h->data[0];                                                                  \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline int fh_##name##_pop(FixedHeap_##name *h, T *out) {                        \
+        if (!h || h->size == 0) {                                                           \
+            return -1;                                                                      \
+        }                                                                                   \
+        if (out) {                                                                          \
+            *out = h->data[0];                                                              \
+        }                                                                                   \
+        T value = h->data[--h->size];                                                       \
+        size_t i = 0;                                                                       \
+        /* Move the hole down past every child that ranks above the last element */         \
+        while (2 * i + 1 < h->size) {                                                       \
+            size_t child = 2 * i + 1;                                                       \
+            if (child + 1 < h->size && less(&h->data[child], &h->data[child + 1])) {        \
+                child++;                                                                    \
+            }                                                                               \
+            if (!less(&value, &h->data[child])) {                                           \
+                break;                                                                      \
+            }                                                                               \
+            h->data[i] = h->data[child];                                                    \
+            i = child;                                                                      \
+        }                                                                                   \
+        if (h->size > 0) {                                                                  \
+            h->data[i] = value;                                                             \
+        }                                                                                   \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline size_t fh_##name##_size(const FixedHeap_##name *h) {                      \
+        return h ? h->size : 0;                                                             \
+    }                                                                                       \
+                                                                                            \
+    static inline int fh_##name##_full(const FixedHeap_##name *h) {                         \
+        return h && h->size >= (N);                                                         \
+    }
+
+/*
+ * Open-addressing hash map with linear probing and N slots
+ * Deletion shifts entries back instead of leaving deleted markers, which could
+ * otherwise fill a map that can never rehash to clear them
+ */
+#define DEFINE_FIXED_HASHMAP_KEYED(name, K, V, N, hash, equal)                              \
+    _Static_assert((N) > 1 && ((N) & ((N) - 1)) == 0, "fixed hash map capacity must be a power of two"); \
+    typedef struct FixedHashMapSlot_##name {                                                \
+        K key;                                                                              \
+        V value;                                                                            \
+    } FixedHashMapSlot_##name;                                                              \
+                                                                                            \
+    typedef struct FixedHashMap_##name {                                                    \
+        FixedHashMapSlot_##name slots[N];                                                   \
+        unsigned char states[N];                                                            \
+        size_t count;                                                                       \
+    } FixedHashMap_##name;                                                                  \
+                                                                                            \
+    static inline void fht_##name##_init(FixedHashMap_##name *map) {                        \
+        memset(map->states, TYPED_SLOT_EMPTY, sizeof(map->states));                         \
+        map->count = 0;                                                                     \
+    }                                                                                       \
+                                                                                            \
+    /* Returns the slot holding key, or the empty slot that ends its probe run */           \
+    static inline size_t fht_##name##_probe(const FixedHashMap_##name *map, const K *key, int *found) { \
+        size_t index = (size_t) hash(key) & ((N) - 1);                                      \
+        while (map->states[index] != TYPED_SLOT_EMPTY) {                                    \
+            if (equal(&map->slots[index].key, key)) {                                       \
+                *found = 1;                                                                 \
+                return index;                                                               \
+            }                                                                               \
+            index = (index + 1) & ((N) - 1);                                                \
+        }                                                                                   \
+        *found = 0;                                                                         \
+        return index;                                                                       \
+    }                                                                                       \
+                                                                                            \
+    /* Inserts or updates a key; returns -1 for a new key once TYPED_FIXED_MAX_ENTRIES(N) are stored */ \
+    static inline int fht_##name##_insert(FixedHashMap_##name *map, K key, V value) {       \
+        if (!map) {                                                                         \
+            return -1;                                                                      \
+        }                                                                                   \
+        int found;                                                                          \
+        size_t index = fht_##name##_probe(map, &key, &found);                               \
+        if (!found) {                                                                       \
+            if (map->count >= TYPED_FIXED_MAX_ENTRIES(N)) {                                 \
+                return -1;                                                                  \
+            }                                                                               \
+            map->states[index] = TYPED_SLOT_FULL;                                           \
+            map->slots[index].key = key;                                                    \
+            map->count++;                                                                   \
+        }                                                                                   \
+        map->slots[index].value = value;                                                    \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    /* Returns a pointer to the stored value, or NULL if the key is absent */               \
+    static inline V *fht_##name##_search(FixedHashMap_##name *map, K key) {                 \
+        if (!map) {                                                                         \
+            return NULL;                                                                    \
+        }                                                                                   \
+        int found;                                                                          \
+        size_t index = fht_##name##_probe(map, &key, &found);                               \
+        return found ? &map->slots[index].value : NULL;                                     \
+    }                                                                                       \
+                                                                                            \
+    /*                                                                                      \
+     * Removes a key by shifting later entries of its probe run back into the gap,          \
+     * so no deleted markers build up and probe lengths stay bounded by the load            \
+     */                                                                                     \
+    static inline int fht_##name##_delete(FixedHashMap_##name *map, K key) {                \
+        if (!map) {                                                                         \
+            return -1;                                                                      \
+        }                                                                                   \
+        int found;                                                                          \
+        size_t hole = fht_##name##_probe(map, &key, &found);                                \
+        if (!found) {                                                                       \
+            return -1;                                                                      \
+        }                                                                                   \
+        for (size_t index = (hole + 1) & ((N) - 1); map->states[index] != TYPED_SLOT_EMPTY; \
+             index = (index + 1) & ((N) - 1)) {                                             \
+            size_t home = (size_t) hash(&map->slots[index].key) & ((N) - 1);                \
+            /* An entry may fill the hole only if the hole lies on its path from home */    \
+            if (((index - home) & ((N) - 1)) >= ((index - hole) & ((N) - 1))) {             \
+                map->slots[hole] = map->slots[index];                                       \
+                hole = index;                                                               \
+            }                                                                               \
+        }                                                                                   \
+        map->states[hole] = TYPED_SLOT_EMPTY;                                               \
+        map->count--;                                                                       \
+        return 0;                                                                           \
+    }                                                                                       \
+                                                                                            \
+    static inline size_t fht_##name##_size(const FixedHashMap_##name *map) {                \
+        return map ? map->count : 0;                                                        \
+    }                                                                                       \
+                                                                                            \
+    static inline int fht_##name##_full(const FixedHashMap_##name *map) {                   \
+        return map && map->count >= TYPED_FIXED_MAX_ENTRIES(N);                             \
+    }                                                                                       \
+                                                                                            \
+    /* Iterates over live entries: start with *cursor = 0 and call until it returns -1 */   \
+    static inline int fht_##name##_next(FixedHashMap_##name *map, size_t *cursor, K *key, V **value) { \
+        for (; map && *cursor < (N); (*cursor)++) {                                         \
+            if (map->states[*cursor] == TYPED_SLOT_FULL) {                                  \
+                if (key) {                                                                  \
+                    *key = map->slots[*cursor].key;                                         \
+                }                                                                           \
+                if (value) {                                                                \
+                    *value = &map->slots[*cursor].value;                                    \
+                }                                                                           \
+                (*cursor)++;                                                                \
+                return 0;                                                                   \
+            }                                                                               \
+        }                                                                                   \
+        return -1;                                                                          \
+    }
+
+// Fixed hash map keyed by uint64_t
+#define DEFINE_FIXED_HASHMAP(name, V, N) \
+    DEFINE_FIXED_HASHMAP_KEYED(name, uint64_t, V, N, typed_hash_u64, typed_equal_u64)
+
+#endif
@@ -0,0 +1,538 @@
+#define _GNU_SOURCE     // mremap
+
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "allocator.h"
+
+#define ARENA_ALIGNMENT alignof(max_align_t)   // Every arena allocation is aligned for any type
+#define DEFAULT_BLOCK_SIZE (64 * 1024)          // Arena block size used when the caller passes 0
+#define POOL_MIN_SHIFT 4                        // Smallest pool size class is 16 bytes
+#define POOL_CLASSES 9                          // Size classes 16, 32, ..., 4096 bytes
+#define POOL_CHUNK_SIZE (64 * 1024)             // Memory carved into blocks when a class runs dry
+#define MMAP_THRESHOLD (2 * 1024 * 1024)        // Blocks of at least one huge page get their own mapping
+
+/* ---------- Default allocator ---------- */
+
+static void *default_alloc(void *context, size_t size) {
+    (void) context;
+    return malloc(size);
+}
+
+static void *default_realloc(void *context, void *ptr, size_t old_size, size_t new_size) {
+    (void) context;
+    (void) old_size;
+    return realloc(ptr, new_size);
+}
+
+static void default_free(void *context, void *ptr, size_t size) {
+    (void) context;
+    (void) size;
+    free(ptr);
+}
+
+static const Allocator default_allocator = {
+    default_alloc, default_realloc, default_free, NULL
+};
+
+/*
+ * Returns the malloc-backed allocator used by every plain *_create function
+ */
+const Allocator *allocator_default() {
+    return &default_allocator;
+}
+
+/* ---------- Bump arena ---------- */
+
+// One contiguous region the arena hands out memory from
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t capacity;    // Usable bytes after the header
+    size_t used;        // Bytes handed out so far
+    alignas(max_align_t) unsigned char data[];
+} ArenaBlock;
+
+/*
+ * Structure for a bump allocator
+ * Blocks are kept across arena_reset so a reused arena stops calling malloc
+ */
+typedef struct Arena {
+    ArenaBlock *first;
+    ArenaBlock *current;    // Block new allocations are carved from
+    size_t block_size;      // Capacity of regular blocks
+    void *last;             // Most recent allocation, the only one that can grow or shrink in place
+} Arena;
+
+static size_t arena_round(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+static ArenaBlock *arena_block_create(size_t capacity) {
+    ArenaBlock *block = malloc(sizeof(ArenaBlock) + capacity);
+
+    if (!block) {
+        return NULL;
+    }
+
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+
+    return block;
+}
+
+/*
+ * Creates an arena whose blocks hold block_size bytes (DEFAULT_BLOCK_SIZE if 0)
+ * Larger requests get a dedicated block
+ */
+Arena *arena_create(size_t block_size) {
+    Arena *arena = malloc(sizeof(Arena));
+
+    if (!arena) {
+        return NULL;
+    }
+
+    arena->block_size = arena_round(block_size ? block_size : DEFAULT_BLOCK_SIZE);
+    arena->first = arena_block_create(arena->block_size);
+
+    if (!arena->first) {
+        free(arena);
+        return NULL;
+    }
+
+    arena->current = arena->first;
+    arena->last = NULL;
+
+    return arena;
+}
+
+/*
+ * Releases every block and the arena itself
+ * Any structure still using the arena must not be touched afterwards
+ */
+int arena_free(Arena *arena) {
+    if (!arena) {
+        return -1;
+    }
+
+    ArenaBlock *current_block = arena->first;
+
+    while (current_block != NULL) {
+        ArenaBlock *next_block = current_block->next;
+        free(current_block);
+        current_block = next_block;
+    }
+
+    free(arena);
+
+    return 0;
+}
+
+/*
+ * Makes every block available again in O(number of blocks)
+ * All memory handed out since creation or the last reset becomes invalid at once
+ */
+void arena_reset(Arena *arena) {
+    if (!arena) {
+        return;
+    }
+
+    for (ArenaBlock *block = arena->first; block != NULL; block = block->next) {
+        block->used = 0;
+    }
+
+    arena->current = arena->first;
+    arena->last = NULL;
+}
+
+/*
+ * Returns the number of bytes handed out since creation or the last reset
+ */
+size_t arena_used(Arena *arena) {
+    if (!arena) {
+        return 0;
+    }
+
+    size_t total = 0;
+
+    for (ArenaBlock *block = arena->first; block != NULL; block = block->next) {
+        total += block->used;
+    }
+
+    return total;
+}
+
+static void *arena_alloc(void *context, size_t size) {
+    Arena *arena = context;
+    size_t needed = arena_round(size ? size : 1);
+    ArenaBlock *block = arena->current;
+
+    // Move on to a later block with room, or splice a new one in after the current block
+    while (block->used + needed > block->capacity) {
+        if (block->next && block->next->capacity - block->next->used >= needed) {
+            block = block->next;
+            continue;
+        }
+
+        ArenaBlock *fresh = arena_block_create(needed > arena->block_size ? needed : arena->block_size);
+        if (!fresh) {
+            return NULL;
+        }
+
+        fresh->next = block->next;
+        block->next = fresh;
+        block = fresh;
+    }
+
+    void *ptr = block->data + block->used;
+    block->used += needed;
+    arena->current = block;
+    arena->last = ptr;
+
+    return ptr;
+}
+
+static void *arena_realloc(void *context, void *ptr, size_t old_size, size_t new_size) {
+    Arena *arena = context;
+
+    if (!ptr) {
+        return arena_alloc(context, new_size);
+    }
+
+    // The latest allocation can grow in place when its block has room
+    if (ptr == arena->last) {
+        ArenaBlock *block = arena->current;
+        size_t offset = (size_t) ((unsigned char *) ptr - block->data);
+        size_t needed = arena_round(new_size ? new_size : 1);
+
+        if (offset + needed <= block->capacity) {
+            block->used = offset + needed;
+            return ptr;
+        }
+    }
+
+    void *buffer = arena_alloc(context, new_size);
+
+    if (buffer) {
+        memcpy(buffer, ptr, old_size < new_size ? old_size : new_size);
+    }
+
+    return buffer;
+}
+
+static void arena_release(void *context, void *ptr, size_t size) {
+    Arena *arena = context;
+    (void) size;
+
+    // Only the latest allocation can be handed back; everything else waits for a reset
+    if (ptr == arena->last) {
+        ArenaBlock *block = arena->current;
+        block->used = (size_t) ((unsigned char *) ptr - block->data);
+        arena->last = NULL;
+    }
+}
+
+/*
+ * Returns an allocator that carves memory out of the arena
+ * The arena must outlive every structure created with it
+ */
+Allocator arena_allocator(Arena *arena) {
+    Allocator allocator = {arena_alloc, arena_realloc, arena_release, arena};
+    return allocator;
+}
+
+/* ---------- Thread-local pool ---------- */
+
+// A free block, linked through its own first bytes
+typedef struct PoolBlock {
+    struct PoolBlock *next;
+} PoolBlock;
+
+// Per-thread free lists and the chunk currently being carved
+typedef struct PoolCache {
+    PoolBlock *free_lists[POOL_CLASSES];
+    unsigned char *chunk;
+    size_t chunk_left;
+    int registered;
+} PoolCache;
+
+static _Thread_local PoolCache pool_cache;
+
+// Blocks left behind by exited threads, adopted by threads whose lists run dry
+static pthread_mutex_t depot_lock = PTHREAD_MUTEX_INITIALIZER;
+static PoolBlock *depot[POOL_CLASSES];
+static atomic_int depot_nonempty[POOL_CLASSES];
+
+static pthread_key_t pool_key;
+static pthread_once_t pool_key_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Hands an exiting thread's free blocks to the depot so they are not lost
+ * The thread's partially used chunk is abandoned, since blocks carved from it may still be live
+ */
+static void pool_thread_exit(void *arg) {
+    PoolCache *cache = arg;
+
+    pthread_mutex_lock(&depot_lock);
+    for (int c = 0; c < POOL_CLASSES; c++) {
+        PoolBlock *block = cache->free_lists[c];
+
+        while (block != NULL) {
+            PoolBlock *next = block->next;
+            block->next = depot[c];
+            depot[c] = block;
+            block = next;
+        }
+
+        cache->free_lists[c] = NULL;
+        atomic_store(&depot_nonempty[c], depot[c] != NULL);
+    }
+    pthread_mutex_unlock(&depot_lock);
+}
+
+static void pool_make_key() {
+    pthread_key_create(&pool_key, pool_thread_exit);
+}
+
+/*
+ * Returns the size class for a request, or -1 if it is served by malloc directly
+ */
+static int pool_class(size_t size) {
+    size_t class_size = (size_t) 1 << POOL_MIN_SHIFT;
+
+    for (int c = 0; c < POOL_CLASSES; c++, class_size <<= 1) {
+        if (size <= class_size) {
+            return c;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * Arranges for pool_thread_exit to run when the calling thread exits
+ * Needed before a thread's lists first gain a block, whether it allocates or only frees
+ */
+static void pool_register(PoolCache *cache) {
+    if (!cache->registered) {
+        pthread_once(&pool_key_once, pool_make_key);
+        pthread_setspecific(pool_key, cache);
+        cache->registered = 1;
+    }
+}
+
+/*
+ * Refills an empty free list, first from the depot and then by carving the current chunk
+ */
+static PoolBlock *pool_refill(PoolCache *cache, int c) {
+    pool_register(cache);
+
+    if (atomic_load_explicit(&depot_nonempty[c], memory_order_relaxed)) {
+        pthread_mutex_lock(&depot_lock);
+        PoolBlock *adopted = depot[c];
+        depot[c] = NULL;
+        atomic_store(&depot_nonempty[c], 0);
+        pthread_mutex_unlock(&depot_lock);
+
+        if (adopted) {
+            return adopted;
+        }
+    }
+
+    size_t class_size = (size_t) 1 << (POOL_MIN_SHIFT + c);
+
+    if (cache->chunk_left < class_size) {
+        // Chunks stay owned by the pool for the life of the process
+        cache->chunk = malloc(POOL_CHUNK_SIZE);
+        if (!cache->chunk) {
+            cache->chunk_left = 0;
+            return NULL;
+        }
+        cache->chunk_left = POOL_CHUNK_SIZE;
+    }
+
+    PoolBlock *block = (PoolBlock *) cache->chunk;
+    block->next = NULL;
+    cache->chunk += class_size;
+    cache->chunk_left -= class_size;
+
+    return block;
+}
+
+static void *pool_alloc(void *context, size_t size) {
+    (void) context;
+    int c = pool_class(size);
+
+    if (c < 0) {
+        return malloc(size);
+    }
+
+    PoolCache *cache = &pool_cache;
+    PoolBlock *block = cache->free_lists[c];
+
+    if (!block) {
+        block = pool_refill(cache, c);
+        if (!block) {
+            return NULL;
+        }
+    }
+
+    cache->free_lists[c] = block->next;
+
+    return block;
+}
+
+static void pool_release(void *context, void *ptr, size_t size) {
+    (void) context;
+    int c = pool_class(size);
+
+    if (c < 0) {
+        free(ptr);
+        return;
+    }
+
+    // The block joins the freeing thread's list, whichever thread allocated it
+    PoolCache *cache = &pool_cache;
+    PoolBlock *block = ptr;
+
+    pool_register(cache);
+    block->next = cache->free_lists[c];
+    cache->free_lists[c] = block;
+}
+
+static void *pool_realloc(void *context, void *ptr, size_t old_size, size_t new_size) {
+    if (!ptr) {
+        return pool_alloc(context, new_size);
+    }
+
+    int old_class = pool_class(old_size);
+    int new_class = pool_class(new_size);
+
+    if (old_class < 0 && new_class < 0) {
+        return realloc(ptr, new_size);
+    }
+
+    if (old_class == new_class) {
+        return ptr;
+    }
+
+    void *buffer = pool_alloc(context, new_size);
+
+    if (buffer) {
+        memcpy(buffer, ptr, old_size < new_size ? old_size : new_size);
+        pool_release(context, ptr, old_size);
+    }
+
+    return buffer;
+}
+
+static const Allocator pool = {
+    pool_alloc, pool_realloc, pool_release, NULL
+};
+
+/*
+ * Returns the thread-local pool allocator
+ * Blocks up to 4 KiB come from per-thread free lists without locking; larger ones use malloc
+ */
+const Allocator *pool_allocator() {
+    return &pool;
+}
+
+/* ---------- mmap backend ---------- */
+
+#ifdef __linux__
+
+static size_t mmap_length(size_t size) {
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+
+    return (size + page_size - 1) & ~(page_size - 1);
+}
+
+static void *mmap_map(size_t size) {
+    size_t length = mmap_length(size);
+    void *ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (ptr == MAP_FAILED) {
+        return NULL;
+    }
+
+#ifdef MADV_HUGEPAGE
+    // Only advice: the kernel backs whatever 2 MiB-aligned ranges it can with huge pages
+    madvise(ptr, length, MADV_HUGEPAGE);
+#endif
+
+    return ptr;
+}
+
+static void *mmap_alloc(void *context, size_t size) {
+    (void) context;
+    return size < MMAP_THRESHOLD ? malloc(size) : mmap_map(size);
+}
+
+static void mmap_release(void *context, void *ptr, size_t size) {
+    (void) context;
+
+    if (size < MMAP_THRESHOLD) {
+        free(ptr);
+    } else {
+        munmap(ptr, mmap_length(size));
+    }
+}
+
+static void *mmap_realloc(void *context, void *ptr, size_t old_size, size_t new_size) {
+    if (!ptr) {
+        return mmap_alloc(context, new_size);
+    }
+
+    int old_mapped = old_size >= MMAP_THRESHOLD;
+    int new_mapped = new_size >= MMAP_THRESHOLD;
+
+    if (!old_mapped && !new_mapped) {
+        return realloc(ptr, new_size);
+    }
+
+    // The kernel moves page table entries instead of copying, and the huge page advice moves with them
+    if (old_mapped && new_mapped) {
+        void *moved = mremap(ptr, mmap_length(old_size), mmap_length(new_size), MREMAP_MAYMOVE);
+        return moved == MAP_FAILED ? NULL : moved;
+    }
+
+    // Crossing the threshold changes backends, which needs one copy
+    void *buffer = mmap_alloc(context, new_size);
+
+    if (buffer) {
+        memcpy(buffer, ptr, old_size < new_size ? old_size : new_size);
+        mmap_release(context, ptr, old_size);
+    }
+
+    return buffer;
+}
+
+static const Allocator mmap_backend = {
+    mmap_alloc, mmap_realloc, mmap_release, NULL
+};
+
+#endif
+
+/*
+ * Returns the allocator for very large arrays
+ * Blocks of 2 MiB and more are private anonymous mappings advised to use huge pages,
+ * and resizing them uses mremap, so growth needs neither a copy nor twice the memory;
+ * smaller blocks use malloc. Falls back to the default allocator outside Linux
+ */
+const Allocator *mmap_allocator() {
+#ifdef __linux__
+    return &mmap_backend;
+#else
+    return allocator_default();
+#endif
+}
@@ -0,0 +1,205 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "functions.h"
+
+#define BF_BLOCK_BITS 512       // One cache line per block
+#define BF_BLOCK_WORDS (BF_BLOCK_BITS / 64)
+#define BF_MAX_PROBES 16        // Cap on bits set per key
+#define BF_PROBE_BITS 9         // log2(BF_BLOCK_BITS), the bits that pick one probe's bit
+
+// One cache-line-aligned block; every bit of a key lands in the same block
+typedef struct BloomBlock {
+    _Alignas(64) uint64_t words[BF_BLOCK_WORDS];
+} BloomBlock;
+
+/*
+ * Structure for a blocked Bloom filter
+ * A key picks one block, then sets or tests k bits inside it, so a query
+ * touches a single cache line however small the false positive rate is
+ */
+typedef struct BloomFilter {
+    BloomBlock *blocks;
+    size_t block_count;
+    unsigned probes;    // k, the number of bits per key
+} BloomFilter;
+
+/*
+ * Multiply-xorshift finalizer, so callers may pass hashes with weak high or low bits
+ */
+static uint64_t bf_mix(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+/*
+ * 64-bit FNV-1a over a string key
+ */
+static uint64_t bf_hash(const char *key) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; key[i] != '\0'; i++) {
+        hash ^= (unsigned char) key[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+/*
+ * Maps the high half of the hash onto a block without a division
+ */
+static BloomBlock *bf_block(BloomFilter *bf, uint64_t hash) {
+    return &bf->blocks[((hash >> 32) * (uint64_t) bf->block_count) >> 32];
+}
+
+// Odd multipliers, one per probe; each gives a different, well-spread view of the hash
+static const uint64_t bf_salts[BF_MAX_PROBES] = {
+    0x47b6137b44974d91ULL, 0x8824ad5ba2b7289dULL, 0x705495c72df1424bULL, 0x9efc49475c6bfb31ULL,
+    0xa2b0b1c8cd0b3d6bULL, 0x2df1424b9efc4947ULL, 0x5c6bfb3144974d91ULL, 0xc2b2ae3d27d4eb4fULL,
+    0x165667b19e3779b9ULL, 0xd6e8feb86659fd93ULL, 0x9e3779b97f4a7c15ULL, 0xbf58476d1ce4e5b9ULL,
+    0x94d049bb133111ebULL, 0xff51afd7ed558ccdULL, 0xc4ceb9fe1a85ec53ULL, 0x87c37b91114253d5ULL,
+};
+
+/*
+ * Returns probe i's bit within the block: the top 9 bits of the hash times its salt
+ * Each probe reads fresh bits, so two keys in the same block overlap only by chance;
+ * probes derived as a + i * b from one hash would share whole runs of bits between
+ * keys with equal b
+ */
+static unsigned bf_probe(uint64_t hash, unsigned i) {
+    return (unsigned) ((hash * bf_salts[i]) >> (64 - BF_PROBE_BITS));
+}
+
+/*
+ * Creates a filter sized for expected_keys at the given false positive rate
+ * Uses about 1.44 * log2(1 / rate) bits per key; blocks fill unevenly, so the measured
+ * rate lands above the target at low rates, about 3x at 0.0001
+ */
+BloomFilter *bf_create(size_t expected_keys, double false_positive_rate) {
+    if (!(false_positive_rate > 0.0 && false_positive_rate < 1.0)) {
+        return NULL;
+    }
+
+    double bits_per_key = -log(false_positive_rate) / (M_LN2 * M_LN2);
+    double bits = bits_per_key * (double) (expected_keys > 0 ? expected_keys : 1);
+    double blocks = ceil(bits / BF_BLOCK_BITS);
+
+    if (blocks > (double) UINT32_MAX) {
+        return NULL;
+    }
+
+    BloomFilter *bf = malloc(sizeof(BloomFilter));
+
+    if (!bf) {
+        return NULL;
+    }
+
+    bf->block_count = (size_t) blocks;
+    bf->blocks = aligned_alloc(64, bf->block_count * sizeof(BloomBlock));
+
+    if (!bf->blocks) {
+        free(bf);
+        return NULL;
+    }
+
+    // k = bits per key * ln 2 minimizes the false positive rate
+    long probes = lround(bits_per_key * M_LN2);
+    bf->probes = (unsigned) (probes < 1 ? 1 : probes > BF_MAX_PROBES ? BF_MAX_PROBES : probes);
+
+    bf_clear(bf);
+
+    return bf;
+}
+
+/*
+ * Frees the filter and its blocks
+ */
+int bf_free(BloomFilter *bf) {
+    if (!bf) {
+        return -1;
+    }
+
+    free(bf->blocks);
+    free(bf);
+
+    return 0;
+}
+
+/*
+ * Forgets every key
+ */
+void bf_clear(BloomFilter *bf) {
+    if (bf) {
+        memset(bf->blocks, 0, bf->block_count * sizeof(BloomBlock));
+    }
+}
+
+/*
+ * Adds an item given its 64-bit hash, for callers that already hash their keys
+ */
+void bf_add_hash(BloomFilter *bf, uint64_t hash) {
+    if (!bf) {
+        return;
+    }
+
+    hash = bf_mix(hash);
+    BloomBlock *block = bf_block(bf, hash);
+
+    for (unsigned i = 0; i < bf->probes; i++) {
+        unsigned bit = bf_probe(hash, i);
+        block->words[bit / 64] |= (uint64_t) 1 << (bit % 64);
+    }
+}
+
+/*
+ * Returns 0 if no item with this hash was added, 1 if one may have been
+ */
+int bf_contains_hash(BloomFilter *bf, uint64_t hash) {
+    if (!bf) {
+        return 0;
+    }
+
+    hash = bf_mix(hash);
+    const BloomBlock *block = bf_block(bf, hash);
+    uint64_t missing = 0;
+
+    // Every probe hits the same cache line, so testing all k bits without an early
+    // exit is cheaper than k hard-to-predict branches
+    for (unsigned i = 0; i < bf->probes; i++) {
+        unsigned bit = bf_probe(hash, i);
+        missing |= ~block->words[bit / 64] & ((uint64_t) 1 << (bit % 64));
+    }
+
+    return missing == 0;
+}
+
+/*
+ * Adds a key; later bf_contains calls for it always return 1
+ */
+void bf_add(BloomFilter *bf, char *key) {
+    if (key) {
+        bf_add_hash(bf, bf_hash(key));
+    }
+}
+
+/*
+ * Returns 0 if the key was definitely never added, 1 if it may have been
+ */
+int bf_contains(BloomFilter *bf, char *key) {
+    return key ? bf_contains_hash(bf, bf_hash(key)) : 0;
+}
+
+/*
+ * Returns the bytes used by the filter's bit array
+ */
+size_t bf_memory(BloomFilter *bf) {
+    return bf ? bf->block_count * sizeof(BloomBlock) : 0;
+}
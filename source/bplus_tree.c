@@ -0,0 +1,571 @@
+#include <math.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "functions.h"
+#include "simd_kernels.h"
+
+#define BT_NODE_KEYS 32                     // Keys per node: four cache lines of doubles
+#define BT_MIN_KEYS (BT_NODE_KEYS / 2 - 1)  // Fewest keys a non-root node may hold
+#define BT_NODE_ALIGNMENT 64                // Nodes start on a cache line so key scans touch whole lines
+
+/*
+ * One node of the tree
+ * Leaves pair keys[i] with values[i] and link to the next leaf for range scans.
+ * Inner nodes hold count separators and count + 1 children: child i covers
+ * keys[i - 1] <= key < keys[i]
+ */
+typedef struct BTreeNode {
+    alignas(BT_NODE_ALIGNMENT) double keys[BT_NODE_KEYS];
+    union {
+        double values[BT_NODE_KEYS];
+        struct BTreeNode *children[BT_NODE_KEYS + 1];
+    };
+    struct BTreeNode *next;     // Next leaf in key order (leaves only)
+    uint16_t count;             // Keys currently stored
+    uint8_t leaf;
+} BTreeNode;
+
+// Structure for an ordered map from double keys to double values
+typedef struct BTree {
+    BTreeNode *root;
+    size_t size;    // Number of key-value pairs
+} BTree;
+
+static BTreeNode *bt_node_create(int leaf) {
+    BTreeNode *node = aligned_alloc(BT_NODE_ALIGNMENT, sizeof(BTreeNode));
+
+    if (!node) {
+        return NULL;
+    }
+
+    node->next = NULL;
+    node->count = 0;
+    node->leaf = (uint8_t) leaf;
+
+    return node;
+}
+
+static void bt_node_free(BTreeNode *node) {
+    if (!node->leaf) {
+        for (size_t i = 0; i <= node->count; i++) {
+            bt_node_free(node->children[i]);
+        }
+    }
+
+    free(node);
+}
+
+/*
+ * Index of the child whose range holds key: the number of separators <= key
+ */
+static size_t bt_child_index(const BTreeNode *node, double key) {
+    return node->count - simd_count_above(node->keys, node->count, key);
+}
+
+/*
+ * Index of the first leaf key >= key: the number of keys < key
+ */
+static size_t bt_leaf_index(const BTreeNode *node, double key) {
+    return simd_count_below(node->keys, node->count, key);
+}
+
+/*
+ * Creates an empty tree whose root is an empty leaf
+ */
+BTree *bt_create() {
+    BTree *bt = malloc(sizeof(BTree));
+
+    if (!bt) {
+        return NULL;
+    }
+
+    bt->root = bt_node_create(1);
+
+    if (!bt->root) {
+        free(bt);
+        return NULL;
+    }
+
+    bt->size = 0;
+
+    return bt;
+}
+
+/*
+ * Frees every node and the tree itself
+ */
+int bt_free(BTree *bt) {
+    if (!bt) {
+        return -1;
+    }
+
+    bt_node_free(bt->root);
+    free(bt);
+
+    return 0;
+}
+
+/*
+ * Splits the full child i of parent in two and adds the separator to parent
+ * parent must have room for one more key
+ */
+static int bt_split_child(BTreeNode *parent, size_t i) {
+    BTreeNode *child = parent->children[i];
+    BTreeNode *right = bt_node_create(child->leaf);
+
+    if (!right) {
+        return -1;
+    }
+
+    double separator;
+
+    if (child->leaf) {
+        // Leaves keep every key, so the right half's first key is copied up
+        size_t keep = BT_NODE_KEYS / 2;
+        right->count = (uint16_t) (child->count - keep);
+        memcpy(right->keys, child->keys + keep, right->count * sizeof(double));
+        memcpy(right->values, child->values + keep, right->count * sizeof(double));
+        child->count = (uint16_t) keep;
+
+        right->next = child->next;
+        child->next = right;
+        separator = right->keys[0];
+    } else {
+        // Inner nodes move the middle key up
+        size_t middle = BT_NODE_KEYS / 2;
+        right->count = (uint16_t) (child->count - middle - 1);
+        memcpy(right->keys, child->keys + middle + 1, right->count * sizeof(double));
+        memcpy(right->children, child->children + middle + 1, (right->count + 1) * sizeof(BTreeNode *));
+        separator = child->keys[middle];
+        child->count = (uint16_t) middle;
+    }
+
+    memmove(parent->keys + i + 1, parent->keys + i, (parent->count - i) * sizeof(double));
+    memmove(parent->children + i + 2, parent->children + i + 1, (parent->count - i) * sizeof(BTreeNode *));
+    parent->keys[i] = separator;
+    parent->children[i + 1] = right;
+    parent->count++;
+
+    return 0;
+}
+
+/*
+ * Inserts a key-value pair, or replaces the value if the key is already present
+ * Full nodes are split on the way down, so the insert never has to climb back up
+ * Returns -1 for a NaN key or on allocation failure
+ */
+int bt_insert(BTree *bt, double key, double value) {
+    if (!bt || isnan(key)) {
+        return -1;
+    }
+
+    if (bt->root->count == BT_NODE_KEYS) {
+        BTreeNode *root = bt_node_create(0);
+
+        if (!root) {
+            return -1;
+        }
+
+        root->children[0] = bt->root;
+
+        if (bt_split_child(root, 0) != 0) {
+            free(root);
+            return -1;
+        }
+
+        bt->root = root;
+    }
+
+    BTreeNode *node = bt->root;
+
+    while (!node->leaf) {
+        size_t i = bt_child_index(node, key);
+
+        if (node->children[i]->count == BT_NODE_KEYS) {
+            if (bt_split_child(node, i) != 0) {
+                return -1;
+            }
+            if (key >= node->keys[i]) {
+                i++;
+            }
+        }
+
+        node = node->children[i];
+    }
+
+    size_t i = bt_leaf_index(node, key);
+
+    if (i < node->count && node->keys[i] == key) {
+        node->values[i] = value;
+        return 0;
+    }
+
+    memmove(node->keys + i + 1, node->keys + i, (node->count - i) * sizeof(double));
+    memmove(node->values + i + 1, node->values + i, (node->count - i) * sizeof(double));
+    node->keys[i] = key;
+    node->values[i] = value;
+    node->count++;
+    bt->size++;
+
+    return 0;
+}
+
+/*
+ * Returns the value stored under key, or NAN if the key is not present
+ */
+double bt_search(BTree *bt, double key) {
+    if (!bt || isnan(key)) {
+        return NAN;
+    }
+
+    BTreeNode *node = bt->root;
+
+    while (!node->leaf) {
+        node = node->children[bt_child_index(node, key)];
+    }
+
+    size_t i = bt_leaf_index(node, key);
+
+    return (i < node->count && node->keys[i] == key) ? node->values[i] : NAN;
+}
+
+/*
+ * Moves the last entry of child i - 1 to the front of child i
+ */
+static void bt_borrow_left(BTreeNode *parent, size_t i) {
+    BTreeNode *child = parent->children[i];
+    BTreeNode *left = parent->children[i - 1];
+
+    memmove(child->keys + 1, child->keys, child->count * sizeof(double));
+
+    if (child->leaf) {
+        memmove(child->values + 1, child->values, child->count * sizeof(double));
+        child->keys[0] = left->keys[left->count - 1];
+        child->values[0] = left->values[left->count - 1];
+        parent->keys[i - 1] = child->keys[0];
+    } else {
+        // The separator comes down and the left sibling's last key replaces it
+        memmove(child->children + 1, child->children, (child->count + 1) * sizeof(BTreeNode *));
+        child->keys[0] = parent->keys[i - 1];
+        child->children[0] = left->children[left->count];
+        parent->keys[i - 1] = left->keys[left->count - 1];
+    }
+
+    child->count++;
+    left->count--;
+}
+
+/*
+ * Moves the first entry of child i + 1 to the end of child i
+ */
+static void bt_borrow_right(BTreeNode *parent, size_t i) {
+    BTreeNode *child = parent->children[i];
+    BTreeNode *right = parent->children[i + 1];
+
+    if (child->leaf) {
+        child->keys[child->count] = right->keys[0];
+        child->values[child->count] = right->values[0];
+        memmove(right->values, right->values + 1, (right->count - 1) * sizeof(double));
+    } else {
+        child->keys[child->count] = parent->keys[i];
+        child->children[child->count + 1] = right->children[0];
+        memmove(right->children, right->children + 1, right->count * sizeof(BTreeNode *));
+    }
+
+    // For an inner node the old first key moves up; for a leaf the new first key is copied up
+    double moved_up = right->keys[0];
+    memmove(right->keys, right->keys + 1, (right->count - 1) * sizeof(double));
+    right->count--;
+    child->count++;
+    parent->keys[i] = child->leaf ? right->keys[0] : moved_up;
+}
+
+/*
+ * Folds child i + 1 into child i and drops their separator from parent
+ */
+static void bt_merge(BTreeNode *parent, size_t i) {
+    BTreeNode *child = parent->children[i];
+    BTreeNode *right = parent->children[i + 1];
+
+    if (child->leaf) {
+        memcpy(child->keys + child->count, right->keys, right->count * sizeof(double));
+        memcpy(child->values + child->count, right->values, right->count * sizeof(double));
+        child->count = (uint16_t) (child->count + right->count);
+        child->next = right->next;
+    } else {
+        child->keys[child->count] = parent->keys[i];
+        memcpy(child->keys + child->count + 1, right->keys, right->count * sizeof(double));
+        memcpy(child->children + child->count + 1, right->children, (right->count + 1) * sizeof(BTreeNode *));
+        child->count = (uint16_t) (child->count + right->count + 1);
+    }
+
+    memmove(parent->keys + i, parent->keys + i + 1, (parent->count - i - 1) * sizeof(double));
+    memmove(parent->children + i + 1, parent->children + i + 2, (parent->count - i - 1) * sizeof(BTreeNode *));
+    parent->count--;
+
+    free(right);
+}
+
+/*
+ * Makes sure child i holds more than the minimum before the delete descends into it
+ * Returns the index of the child that now covers the same range
+ */
+static size_t bt_fill_child(BTreeNode *parent, size_t i) {
+    if (i > 0 && parent->children[i - 1]->count > BT_MIN_KEYS) {
+        bt_borrow_left(parent, i);
+    } else if (i < parent->count && parent->children[i + 1]->count > BT_MIN_KEYS) {
+        bt_borrow_right(parent, i);
+    } else if (i < parent->count) {
+        bt_merge(parent, i);
+    } else {
+        bt_merge(parent, i - 1);
+        i--;
+    }
+
+    return i;
+}
+
+/*
+ * Removes a key and its value
+ * Thin nodes are topped up on the way down, so the leaf can always give up a key
+ * Returns -1 if the key is not present
+ */
+int bt_delete(BTree *bt, double key) {
+    if (!bt || isnan(key)) {
+        return -1;
+    }
+
+    BTreeNode *node = bt->root;
+
+    while (!node->leaf) {
+        size_t i = bt_child_index(node, key);
+
+        if (node->children[i]->count <= BT_MIN_KEYS) {
+            i = bt_fill_child(node, i);
+
+            // A merge can empty the root, which then gives way to its only child
+            if (node == bt->root && node->count == 0) {
+                bt->root = node->children[0];
+                free(node);
+                node = bt->root;
+                continue;
+            }
+        }
+
+        node = node->children[i];
+    }
+
+    size_t i = bt_leaf_index(node, key);
+
+    if (i >= node->count || node->keys[i] != key) {
+        return -1;
+    }
+
+    memmove(node->keys + i, node->keys + i + 1, (node->count - i - 1) * sizeof(double));
+    memmove(node->values + i, node->values + i + 1, (node->count - i - 1) * sizeof(double));
+    node->count--;
+    bt->size--;
+
+    return 0;
+}
+
+/*
+ * Returns the number of key-value pairs in the tree
+ */
+size_t bt_size(BTree *bt) {
+    return bt ? bt->size : 0;
+}
+
+/*
+ * Positions it at the first key >= low; bt_next then yields pairs in key order up to high
+ * Runs in O(log n), and each bt_next is O(1) by following the leaf links
+ */
+int bt_range(BTree *bt, double low, double high, BTreeIterator *it) {
+    if (!bt || !it || isnan(low) || isnan(high)) {
+        return -1;
+    }
+
+    BTreeNode *node = bt->root;
+
+    while (!node->leaf) {
+        node = node->children[bt_child_index(node, low)];
+    }
+
+    it->leaf = node;
+    it->index = bt_leaf_index(node, low);
+    it->high = high;
+
+    return 0;
+}
+
+/*
+ * Stores the next pair of the range in *key and *value (either may be NULL)
+ * Returns 1 if a pair was produced and 0 once the range is exhausted
+ */
+int bt_next(BTreeIterator *it, double *key, double *value) {
+    if (!it) {
+        return 0;
+    }
+
+    const BTreeNode *node = it->leaf;
+
+    while (node && it->index >= node->count) {
+        node = node->next;
+        it->index = 0;
+    }
+
+    it->leaf = node;
+
+    if (!node || node->keys[it->index] > it->high) {
+        it->leaf = NULL;
+        return 0;
+    }
+
+    if (key) {
+        *key = node->keys[it->index];
+    }
+    if (value) {
+        *value = node->values[it->index];
+    }
+
+    it->index++;
+
+    return 1;
+}
+
+/*
+ * Builds the parents of one level, splitting count nodes as evenly as possible
+ * lows[i] is the smallest key under nodes[i]; both arrays are rewritten to describe the new level
+ * Returns the number of parents, or 0 after freeing the whole level if memory runs out
+ */
+static size_t bt_build_level(BTreeNode **nodes, double *lows, size_t count) {
+    size_t fanout = BT_NODE_KEYS + 1;
+    size_t parents = (count + fanout - 1) / fanout;
+    size_t taken = 0;
+
+    for (size_t p = 0; p < parents; p++) {
+        size_t share = count / parents + (p < count % parents);
+        BTreeNode *parent = bt_node_create(0);
+
+        if (!parent) {
+            // Parents so far own the nodes before 'taken'; the rest are still loose
+            for (size_t j = 0; j < p; j++) {
+                bt_node_free(nodes[j]);
+            }
+            for (size_t j = taken; j < count; j++) {
+                bt_node_free(nodes[j]);
+            }
+            return 0;
+        }
+
+        for (size_t c = 0; c < share; c++) {
+            parent->children[c] = nodes[taken + c];
+            if (c > 0) {
+                parent->keys[c - 1] = lows[taken + c];
+            }
+        }
+
+        parent->count = (uint16_t) (share - 1);
+        lows[p] = lows[taken];
+        nodes[p] = parent;
+        taken += share;
+    }
+
+    return parents;
+}
+
+/*
+ * Packs sorted pairs into linked leaves, spread evenly so none falls below the minimum
+ * Returns -1 after freeing the leaves made so far if memory runs out
+ */
+static int bt_build_leaves(BTreeNode **nodes, double *lows, size_t leaves,
+                           const double *keys, const double *values, size_t n) {
+    size_t offset = 0;
+
+    for (size_t i = 0; i < leaves; i++) {
+        size_t share = n / leaves + (i < n % leaves);
+        BTreeNode *leaf = bt_node_create(1);
+
+        if (!leaf) {
+            for (size_t j = 0; j < i; j++) {
+                free(nodes[j]);
+            }
+            return -1;
+        }
+
+        memcpy(leaf->keys, keys + offset, share * sizeof(double));
+        memcpy(leaf->values, values + offset, share * sizeof(double));
+        leaf->count = (uint16_t) share;
+
+        if (i > 0) {
+            nodes[i - 1]->next = leaf;
+        }
+
+        nodes[i] = leaf;
+        lows[i] = keys[offset];
+        offset += share;
+    }
+
+    return 0;
+}
+
+/*
+ * Builds a tree from n pairs whose keys are strictly ascending, in O(n)
+ * Returns NULL if the keys are not strictly ascending, contain NaN, or memory runs out
+ */
+BTree *bt_build_sorted(const double *keys, const double *values, size_t n) {
+    if ((!keys || !values) && n > 0) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (isnan(keys[i]) || (i > 0 && !(keys[i - 1] < keys[i]))) {
+            return NULL;
+        }
+    }
+
+    BTree *bt = bt_create();
+
+    if (!bt || n == 0) {
+        return bt;
+    }
+
+    size_t level = (n + BT_NODE_KEYS - 1) / BT_NODE_KEYS;     // Nodes in the current level
+
+    // A single leaf is just the root
+    if (level == 1) {
+        memcpy(bt->root->keys, keys, n * sizeof(double));
+        memcpy(bt->root->values, values, n * sizeof(double));
+        bt->root->count = (uint16_t) n;
+        bt->size = n;
+        return bt;
+    }
+
+    BTreeNode **nodes = malloc(level * sizeof(BTreeNode *));
+    double *lows = malloc(level * sizeof(double));
+    int failed = !nodes || !lows || bt_build_leaves(nodes, lows, level, keys, values, n) != 0;
+
+    while (!failed && level > 1) {
+        level = bt_build_level(nodes, lows, level);
+        failed = level == 0;
+    }
+
+    if (failed) {
+        free(nodes);
+        free(lows);
+        bt_free(bt);
+        return NULL;
+    }
+
+    free(bt->root);
+    bt->root = nodes[0];
+    bt->size = n;
+
+    free(nodes);
+    free(lows);
+
+    return bt;
+}
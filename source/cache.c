@@ -0,0 +1,314 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "functions.h"
+
+#define CACHE_MAX_LOAD 0.7  // Buckets are sized once so the full cache stays under this load factor
+
+// One cached pair; its slot doubles as the hash chain node and the recency list node
+typedef struct CacheEntry {
+    char *key;                  // NULL while the slot is free
+    double value;
+    unsigned int hash;          // Full hash, compared before the key
+    int referenced;             // CLOCK mode: set on every hit, cleared as the hand passes
+    struct CacheEntry *chain;   // Next entry in the same bucket, or the next free slot
+    struct CacheEntry *newer;   // LRU mode: neighbours in recency order
+    struct CacheEntry *older;
+} CacheEntry;
+
+// Structure for a bounded string-keyed cache
+typedef struct Cache {
+    CacheEntry **buckets;
+    size_t bucket_mask;         // Bucket count - 1, the count being a power of two
+    CacheEntry *entries;        // All capacity slots, allocated up front
+    CacheEntry *free_slots;
+    size_t capacity;
+    size_t size;
+    CachePolicy policy;
+    CacheEntry *newest;         // LRU mode: list head, moved to on every hit
+    CacheEntry *oldest;         // LRU mode: next victim
+    size_t hand;                // CLOCK mode: slot the hand points at
+    CacheStats stats;
+} Cache;
+
+/*
+ * Creates an empty cache holding at most capacity pairs
+ * Every slot and bucket is allocated here, so later puts only allocate key copies
+ */
+Cache *cache_create(size_t capacity, CachePolicy policy) {
+    if (capacity == 0 || (policy != CACHE_LRU && policy != CACHE_CLOCK)) {
+        return NULL;
+    }
+
+    Cache *c = malloc(sizeof(Cache));
+
+    if (!c) {
+        return NULL;
+    }
+
+    size_t bucket_count = 1;
+
+    while ((double) capacity / bucket_count > CACHE_MAX_LOAD) {
+        bucket_count <<= 1;
+    }
+
+    c->buckets = calloc(bucket_count, sizeof(CacheEntry *));
+    c->entries = calloc(capacity, sizeof(CacheEntry));
+
+    if (!c->buckets || !c->entries) {
+        free(c->buckets);
+        free(c->entries);
+        free(c);
+        return NULL;
+    }
+
+    // Thread every slot onto the free list in order
+    for (size_t i = 0; i + 1 < capacity; i++) {
+        c->entries[i].chain = &c->entries[i + 1];
+    }
+
+    c->bucket_mask = bucket_count - 1;
+    c->free_slots = &c->entries[0];
+    c->capacity = capacity;
+    c->size = 0;
+    c->policy = policy;
+    c->newest = NULL;
+    c->oldest = NULL;
+    c->hand = 0;
+    memset(&c->stats, 0, sizeof(CacheStats));
+
+    return c;
+}
+
+/*
+ * Frees every key copy, the slots, the buckets and the cache itself
+ */
+int cache_free(Cache *c) {
+    if (!c) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < c->capacity; i++) {
+        free(c->entries[i].key);
+    }
+
+    free(c->entries);
+    free(c->buckets);
+    free(c);
+
+    return 0;
+}
+
+static CacheEntry *cache_lookup(Cache *c, char *key, unsigned int hash) {
+    CacheEntry *entry = c->buckets[hash & c->bucket_mask];
+
+    while (entry != NULL) {
+        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+        entry = entry->chain;
+    }
+
+    return NULL;
+}
+
+static void cache_list_unlink(Cache *c, CacheEntry *entry) {
+    if (entry->newer) {
+        entry->newer->older = entry->older;
+    } else {
+        c->newest = entry->older;
+    }
+
+    if (entry->older) {
+        entry->older->newer = entry->newer;
+    } else {
+        c->oldest = entry->newer;
+    }
+}
+
+static void cache_list_push(Cache *c, CacheEntry *entry) {
+    entry->newer = NULL;
+    entry->older = c->newest;
+
+    if (c->newest) {
+        c->newest->newer = entry;
+    } else {
+        c->oldest = entry;
+    }
+
+    c->newest = entry;
+}
+
+/*
+ * Records a hit: LRU relinks the entry at the front, CLOCK only sets its bit
+ */
+static void cache_touch(Cache *c, CacheEntry *entry) {
+    if (c->policy == CACHE_CLOCK) {
+        entry->referenced = 1;
+    } else if (c->newest != entry) {
+        cache_list_unlink(c, entry);
+        cache_list_push(c, entry);
+    }
+}
+
+/*
+ * Unlinks an entry from its bucket and the recency list and returns its slot to the free list
+ */
+static void cache_remove(Cache *c, CacheEntry *entry) {
+    CacheEntry **link = &c->buckets[entry->hash & c->bucket_mask];
+
+    while (*link != entry) {
+        link = &(*link)->chain;
+    }
+    *link = entry->chain;
+
+    if (c->policy == CACHE_LRU) {
+        cache_list_unlink(c, entry);
+    }
+
+    free(entry->key);
+    entry->key = NULL;
+    entry->chain = c->free_slots;
+    c->free_slots = entry;
+    c->size--;
+}
+
+/*
+ * Picks the entry to evict from a full cache
+ * CLOCK sweeps the slots, giving every referenced entry a second chance
+ */
+static CacheEntry *cache_victim(Cache *c) {
+    if (c->policy == CACHE_LRU) {
+        return c->oldest;
+    }
+
+    for (;;) {
+        CacheEntry *entry = &c->entries[c->hand];
+        c->hand = (c->hand + 1) % c->capacity;
+
+        if (!entry->key) {
+            continue;
+        }
+        if (!entry->referenced) {
+            return entry;
+        }
+        entry->referenced = 0;
+    }
+}
+
+/*
+ * Inserts or updates a pair, evicting one entry if the cache is full
+ * Returns -1 if the key copy cannot be allocated
+ */
+int cache_put(Cache *c, char *key, double value) {
+    if (!c || !key) {
+        return -1;
+    }
+
+    unsigned int hash = ht_hash(key);
+    CacheEntry *entry = cache_lookup(c, key, hash);
+
+    if (entry) {
+        entry->value = value;
+        cache_touch(c, entry);
+        return 0;
+    }
+
+    size_t length = strlen(key) + 1;
+    char *copy = malloc(length);
+
+    if (!copy) {
+        return -1;
+    }
+
+    memcpy(copy, key, length);
+
+    if (c->size == c->capacity) {
+        cache_remove(c, cache_victim(c));
+        c->stats.evictions++;
+    }
+
+    entry = c->free_slots;
+    c->free_slots = entry->chain;
+
+    entry->key = copy;
+    entry->value = value;
+    entry->hash = hash;
+    entry->referenced = 1;
+
+    CacheEntry **bucket = &c->buckets[hash & c->bucket_mask];
+    entry->chain = *bucket;
+    *bucket = entry;
+
+    if (c->policy == CACHE_LRU) {
+        cache_list_push(c, entry);
+    }
+
+    c->size++;
+
+    return 0;
+}
+
+/*
+ * Returns the cached value and marks it recently used, or NAN on a miss
+ * A hit costs one hash probe plus an O(1) relink (LRU) or a bit store (CLOCK)
+ */
+double cache_get(Cache *c, char *key) {
+    if (!c || !key) {
+        return NAN;
+    }
+
+    CacheEntry *entry = cache_lookup(c, key, ht_hash(key));
+
+    if (!entry) {
+        c->stats.misses++;
+        return NAN;
+    }
+
+    c->stats.hits++;
+    cache_touch(c, entry);
+
+    return entry->value;
+}
+
+/*
+ * Removes a key from the cache
+ * Returns -1 if the key is not cached
+ */
+int cache_delete(Cache *c, char *key) {
+    if (!c || !key) {
+        return -1;
+    }
+
+    CacheEntry *entry = cache_lookup(c, key, ht_hash(key));
+
+    if (!entry) {
+        return -1;
+    }
+
+    cache_remove(c, entry);
+
+    return 0;
+}
+
+/*
+ * Returns the number of cached pairs
+ */
+size_t cache_size(Cache *c) {
+    return c ? c->size : 0;
+}
+
+/*
+ * Copies the hit, miss and eviction counters into *out
+ */
+int cache_stats(Cache *c, CacheStats *out) {
+    if (!c || !out) {
+        return -1;
+    }
+
+    *out = c->stats;
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+#ifndef GROWTH_INTERNAL_H
+#define GROWTH_INTERNAL_H
+
+#include <stdint.h>
+
+#include "functions.h"
+
+#define GROWTH_DEFAULT_CAPACITY 100     // Starting capacity when the policy leaves it at 0
+#define GROWTH_DEFAULT_FACTOR 2.0       // Growth factor when the policy leaves it at 0
+
+/*
+ * Copies a caller's policy with zero fields replaced by the defaults (NULL means all defaults)
+ * Returns -1 unless growth_factor > 1 and shrink_threshold * growth_factor < 1,
+ * the gap that stops a shrink from being undone by the very next insert
+ */
+static inline int growth_policy_resolve(GrowthPolicy *out, const GrowthPolicy *policy) {
+    GrowthPolicy resolved = {GROWTH_DEFAULT_CAPACITY, GROWTH_DEFAULT_FACTOR, 0.0};
+
+    if (policy) {
+        if (policy->initial_capacity > 0) {
+            resolved.initial_capacity = policy->initial_capacity;
+        }
+        if (policy->growth_factor != 0.0) {
+            resolved.growth_factor = policy->growth_factor;
+        }
+        resolved.shrink_threshold = policy->shrink_threshold;
+    }
+
+    if (!(resolved.growth_factor > 1.0) || !(resolved.shrink_threshold >= 0.0) ||
+        resolved.shrink_threshold * resolved.growth_factor >= 1.0 ||
+        resolved.initial_capacity > SIZE_MAX / sizeof(double)) {
+        return -1;
+    }
+
+    *out = resolved;
+    return 0;
+}
+
+/*
+ * Returns the capacity to grow to from a full array of doubles, or 0 if it would overflow
+ */
+static inline size_t growth_next(const GrowthPolicy *policy, size_t capacity) {
+    double grown = (double) capacity * policy->growth_factor;
+
+    if (grown >= (double) (SIZE_MAX / sizeof(double))) {
+        return 0;
+    }
+
+    size_t next = (size_t) grown;
+
+    return next > capacity ? next : capacity + 1;
+}
+
+/*
+ * Returns the capacity to shrink to once size has dropped below the threshold, or 0 to keep the array
+ * Never goes below the initial capacity
+ */
+static inline size_t growth_shrink_target(const GrowthPolicy *policy, size_t size, size_t capacity) {
+    if (policy->shrink_threshold <= 0.0 || capacity <= policy->initial_capacity ||
+        (double) size >= (double) capacity * policy->shrink_threshold) {
+        return 0;
+    }
+
+    size_t target = (size_t) ((double) capacity / policy->growth_factor);
+
+    if (target < policy->initial_capacity) {
+        target = policy->initial_capacity;
+    }
+
+    return target > size && target < capacity ? target : 0;
+}
+
+#endif
@@ -1,9 +1,17 @@
 #include <math.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "functions.h"
+#include "parallel_internal.h"
+#include "stats_internal.h"
+
 #define DEFAULT_SIZE 100            // The starting number of buckets within the hash table
+#define MAX_LOAD_FACTOR 0.7         // The table doubles once count / buckets goes above this
+#define CHUNK_BUCKETS 64            // Bucket heads per copy-on-write chunk, a power of two
+#define PARALLEL_MIN_BUCKETS 65536  // Smaller tables are rehashed on the calling thread
 
 // Each entry acts as a node in a linked list (separate chaining is used)
 typedef struct Entry {
@@ -12,34 +20,372 @@ typedef struct Entry {
     struct Entry *next; // Pointer to the next entry in the same bucket
 } Entry;
 
+/*
+ * A run of CHUNK_BUCKETS bucket heads, which owns the entries chained from them
+ * Shared between the table and its snapshots; while refs > 1 nobody may change
+ * its chains, so the table copies the chunk before its first write
+ */
+typedef struct BucketChunk {
+    _Atomic(size_t) refs;
+    struct ChunkSlab *slab;     // Block the chunk was carved from, NULL if allocated alone
+    Entry *heads[CHUNK_BUCKETS];
+} BucketChunk;
+
+/*
+ * The chunks of a new directory, allocated as one block so the bucket heads of a
+ * table without snapshots stay contiguous, as in a plain bucket array
+ * Freed once every chunk carved from it has been released
+ */
+typedef struct ChunkSlab {
+    _Atomic(size_t) live;
+    size_t count;
+    BucketChunk chunks[];
+} ChunkSlab;
+
+/*
+ * The bucket array, split into chunks; a snapshot shares it by taking a reference
+ * While refs > 1 the table copies the chunk pointers before replacing any of them
+ */
+typedef struct BucketDirectory {
+    _Atomic(size_t) refs;
+    size_t capacity;            // Buckets in use; the last chunk may have unused heads
+    size_t chunk_count;
+    BucketChunk *chunks[];
+} BucketDirectory;
+
 // The main hash table structure
 typedef struct HashTable {
-    Entry **buckets;        // Array of pointers to Entr (the "bucket" heads)
+    BucketDirectory *buckets; // Bucket heads, reached through their chunks
     size_t count;           // Total number of key-value pairs in the table
     size_t capacity_table;  // Number of available buckets
+    Allocator allocator;    // Source of the table, its buckets, entries and keys
+    BloomFilter *filter;    // Optional membership filter consulted before the buckets
+    double filter_rate;     // False positive rate the filter is rebuilt with
+    size_t filter_stale;    // Keys deleted since the filter was last rebuilt
+    STATS_FIELD             // Operation counters, only present when built with LDS_STATS
 } HashTable;
 
+// Read-only point-in-time view of a table, see ht_snapshot
+typedef struct HashTableSnapshot {
+    BucketDirectory *buckets;
+    size_t count;
+    Allocator allocator;        // The table's allocator, needed to free what the snapshot outlives
+} HashTableSnapshot;
+
+/*
+ * Copies a key into memory owned by the table's allocator
+ */
+static char *ht_copy_key(const Allocator *allocator, const char *key) {
+    size_t length = strlen(key) + 1;
+    char *copy = allocator_alloc(allocator, length);
+
+    if (copy) {
+        memcpy(copy, key, length);
+    }
+
+    return copy;
+}
+
+/*
+ * Releases an entry and the key it owns
+ */
+static void ht_free_entry(const Allocator *allocator, Entry *entry) {
+    allocator_free(allocator, entry->key, strlen(entry->key) + 1);
+    allocator_free(allocator, entry, sizeof(Entry));
+}
+
+/*
+ * Allocates an entry holding its own copy of key
+ */
+static Entry *ht_new_entry(const Allocator *allocator, const char *key, double value) {
+    Entry *entry = allocator_alloc(allocator, sizeof(Entry));
+
+    if (!entry) {
+        return NULL;
+    }
+
+    entry->key = ht_copy_key(allocator, key);   // Duplicate the string to manage its own memory
+    if (!entry->key) {
+        allocator_free(allocator, entry, sizeof(Entry));
+        return NULL;
+    }
+
+    entry->value = value;
+    entry->next = NULL;
+
+    return entry;
+}
+
+static size_t ht_slab_bytes(size_t count) {
+    return sizeof(ChunkSlab) + count * sizeof(BucketChunk);
+}
+
+/*
+ * Frees a chunk's own memory, but not its entries, returning slab chunks to their slab
+ */
+static void ht_chunk_discard(const Allocator *allocator, BucketChunk *chunk) {
+    ChunkSlab *slab = chunk->slab;
+
+    if (!slab) {
+        allocator_free(allocator, chunk, sizeof(BucketChunk));
+    } else if (atomic_fetch_sub_explicit(&slab->live, 1, memory_order_acq_rel) == 1) {
+        allocator_free(allocator, slab, ht_slab_bytes(slab->count));
+    }
+}
+
+/*
+ * Drops one reference to a chunk; the last one frees the chunk and every entry it chains
+ * Any thread may drop a reference, so the allocator must be safe to call from it
+ */
+static void ht_chunk_release(const Allocator *allocator, BucketChunk *chunk) {
+    if (atomic_fetch_sub_explicit(&chunk->refs, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    for (size_t i = 0; i < CHUNK_BUCKETS; i++) {
+        Entry *current_entry = chunk->heads[i];
+
+        while (current_entry != NULL) {
+            Entry *next_entry = current_entry->next;
+            ht_free_entry(allocator, current_entry);   // Also frees the copied key
+            current_entry = next_entry;
+        }
+    }
+
+    ht_chunk_discard(allocator, chunk);
+}
+
+/*
+ * Copies a chunk and every entry it chains, keeping each chain's order
+ */
+static BucketChunk *ht_chunk_copy(const Allocator *allocator, const BucketChunk *chunk) {
+    BucketChunk *copy = allocator_alloc(allocator, sizeof(BucketChunk));
+
+    if (!copy) {
+        return NULL;
+    }
+
+    atomic_init(&copy->refs, 1);
+    copy->slab = NULL;
+    memset(copy->heads, 0, sizeof(copy->heads));
+
+    for (size_t i = 0; i < CHUNK_BUCKETS; i++) {
+        Entry **tail = &copy->heads[i];
+
+        for (Entry *current_entry = chunk->heads[i]; current_entry != NULL; current_entry = current_entry->next) {
+            Entry *entry = ht_new_entry(allocator, current_entry->key, current_entry->value);
+
+            if (!entry) {
+                ht_chunk_release(allocator, copy);
+                return NULL;
+            }
+
+            *tail = entry;
+            tail = &entry->next;
+        }
+    }
+
+    return copy;
+}
+
+static size_t ht_directory_bytes(size_t chunk_count) {
+    return sizeof(BucketDirectory) + chunk_count * sizeof(BucketChunk *);
+}
+
+/*
+ * Allocates a directory of capacity buckets with its chunks carved from one slab
+ * The chunks' refs and heads are left for ht_clear_chunks, so parallel callers can
+ * spread that work over their threads
+ */
+static BucketDirectory *ht_alloc_directory(const Allocator *allocator, size_t capacity) {
+    size_t chunk_count = (capacity + CHUNK_BUCKETS - 1) / CHUNK_BUCKETS;
+    BucketDirectory *buckets = allocator_alloc(allocator, ht_directory_bytes(chunk_count));
+    ChunkSlab *slab = allocator_alloc(allocator, ht_slab_bytes(chunk_count));
+
+    if (!buckets || !slab) {
+        allocator_free(allocator, buckets, ht_directory_bytes(chunk_count));
+        allocator_free(allocator, slab, ht_slab_bytes(chunk_count));
+        return NULL;
+    }
+
+    atomic_init(&slab->live, chunk_count);
+    slab->count = chunk_count;
+
+    atomic_init(&buckets->refs, 1);
+    buckets->capacity = capacity;
+    buckets->chunk_count = chunk_count;
+
+    for (size_t i = 0; i < chunk_count; i++) {
+        slab->chunks[i].slab = slab;
+        buckets->chunks[i] = &slab->chunks[i];
+    }
+
+    return buckets;
+}
+
+/*
+ * Empties chunks [first, last) of a directory from ht_alloc_directory
+ */
+static void ht_clear_chunks(BucketDirectory *buckets, size_t first, size_t last) {
+    for (size_t i = first; i < last; i++) {
+        atomic_init(&buckets->chunks[i]->refs, 1);
+        memset(buckets->chunks[i]->heads, 0, sizeof(buckets->chunks[i]->heads));
+    }
+}
+
+/*
+ * Allocates a directory of capacity empty buckets
+ */
+static BucketDirectory *ht_alloc_buckets(const Allocator *allocator, size_t capacity) {
+    BucketDirectory *buckets = ht_alloc_directory(allocator, capacity);
+
+    if (buckets) {
+        ht_clear_chunks(buckets, 0, buckets->chunk_count);
+    }
+
+    return buckets;
+}
+
+/*
+ * Frees a directory nothing else shares and its chunks' memory, but not their entries
+ */
+static void ht_discard_buckets(const Allocator *allocator, BucketDirectory *buckets) {
+    for (size_t i = 0; i < buckets->chunk_count; i++) {
+        ht_chunk_discard(allocator, buckets->chunks[i]);
+    }
+
+    allocator_free(allocator, buckets, ht_directory_bytes(buckets->chunk_count));
+}
+
+/*
+ * Drops one reference to a directory; the last one releases each of its chunks
+ */
+static void ht_release_buckets(const Allocator *allocator, BucketDirectory *buckets) {
+    if (atomic_fetch_sub_explicit(&buckets->refs, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    for (size_t i = 0; i < buckets->chunk_count; i++) {
+        ht_chunk_release(allocator, buckets->chunks[i]);
+    }
+
+    allocator_free(allocator, buckets, ht_directory_bytes(buckets->chunk_count));
+}
+
+/*
+ * Returns the head of bucket index for reading
+ */
+static inline Entry *ht_bucket(const BucketDirectory *buckets, size_t index) {
+    return buckets->chunks[index / CHUNK_BUCKETS]->heads[index % CHUNK_BUCKETS];
+}
+
+/*
+ * Returns the head slot of bucket index in a directory nothing else shares
+ */
+static inline Entry **ht_bucket_slot(BucketDirectory *buckets, size_t index) {
+    return &buckets->chunks[index / CHUNK_BUCKETS]->heads[index % CHUNK_BUCKETS];
+}
+
+/*
+ * Returns the head of bucket index for writing, first copying the directory and the
+ * bucket's chunk if a snapshot still shares them
+ * Only the table's own thread writes, and only it can raise a count above 1, so a
+ * count of 1 means the object is private until the next ht_snapshot
+ * Returns NULL if a copy cannot be allocated
+ */
+static Entry **ht_bucket_for_write(HashTable *ht, size_t index) {
+    BucketDirectory *buckets = ht->buckets;
+
+    if (atomic_load_explicit(&buckets->refs, memory_order_acquire) > 1) {
+        BucketDirectory *copy = allocator_alloc(&ht->allocator, ht_directory_bytes(buckets->chunk_count));
+
+        if (!copy) {
+            return NULL;
+        }
+
+        atomic_init(&copy->refs, 1);
+        copy->capacity = buckets->capacity;
+        copy->chunk_count = buckets->chunk_count;
+
+        for (size_t i = 0; i < buckets->chunk_count; i++) {
+            copy->chunks[i] = buckets->chunks[i];
+            atomic_fetch_add_explicit(&copy->chunks[i]->refs, 1, memory_order_relaxed);
+        }
+
+        ht_release_buckets(&ht->allocator, buckets);
+        ht->buckets = buckets = copy;
+    }
+
+    BucketChunk **chunk = &buckets->chunks[index / CHUNK_BUCKETS];
+
+    if (atomic_load_explicit(&(*chunk)->refs, memory_order_acquire) > 1) {
+        BucketChunk *copy = ht_chunk_copy(&ht->allocator, *chunk);
+
+        if (!copy) {
+            return NULL;
+        }
+
+        ht_chunk_release(&ht->allocator, *chunk);
+        *chunk = copy;
+    }
+
+    return &(*chunk)->heads[index % CHUNK_BUCKETS];
+}
+
+/*
+ * Returns 1 if a snapshot shares the directory or any chunk
+ */
+static int ht_buckets_shared(const BucketDirectory *buckets) {
+    if (atomic_load_explicit(&buckets->refs, memory_order_acquire) > 1) {
+        return 1;
+    }
+
+    for (size_t i = 0; i < buckets->chunk_count; i++) {
+        if (atomic_load_explicit(&buckets->chunks[i]->refs, memory_order_acquire) > 1) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 /*
  * Creates and initializes a new Hash Table
- * Uses calloc to make sure all bucket pointers start as NULL
+ * All bucket pointers start as NULL
  */
 HashTable *ht_create() {
-    HashTable *ht = malloc(sizeof(HashTable));
+    return ht_create_with_allocator(NULL);
+}
+
+/*
+ * Same as ht_create, but the table, buckets, entries and keys come from the given allocator
+ * Passing NULL selects the default malloc-based allocator
+ */
+HashTable *ht_create_with_allocator(const Allocator *allocator) {
+    if (!allocator) {
+        allocator = allocator_default();
+    }
+
+    HashTable *ht = allocator_alloc(allocator, sizeof(HashTable));
 
     if (!ht) {
         return NULL;
     }
 
-    // calloc initializes the memory to zero, making all buckets NULL by default
-    ht->buckets = calloc(DEFAULT_SIZE, sizeof(Entry *));
+    ht->allocator = *allocator;
+    ht->buckets = ht_alloc_buckets(allocator, DEFAULT_SIZE);
 
     if (!ht->buckets) {
-        free(ht);
+        allocator_free(allocator, ht, sizeof(HashTable));
         return NULL;
     }
 
     ht->count = 0;
     ht->capacity_table = DEFAULT_SIZE;
+    ht->filter = NULL;
+    ht->filter_rate = 0.0;
+    ht->filter_stale = 0;
+    STATS_INIT(ht);
 
     return ht;
 }
@@ -52,23 +398,17 @@ int ht_free(HashTable *ht) {
         return -1;
     }
 
-    if (ht->buckets != NULL) {
-        for (size_t i = 0; i < ht->capacity_table; i++) {
-            Entry *current_entry = ht->buckets[i];
-            Entry *next_entry;
+    STATS_FREE(ht, "hash_table");
 
-            // Traverse and free the linked list in each bucket
-            while (current_entry != NULL) {
-                next_entry = current_entry->next;
-                free(current_entry->key);   // Key was allocated via strdup
-                free(current_entry);
-                current_entry = next_entry;
-            }
-        }
-        free(ht->buckets);
+    Allocator allocator = ht->allocator;
+
+    // Chunks a snapshot still shares, and their entries, are freed with the snapshot
+    if (ht->buckets != NULL) {
+        ht_release_buckets(&allocator, ht->buckets);
     }
 
-    free(ht);
+    bf_free(ht->filter);
+    allocator_free(&allocator, ht, sizeof(HashTable));
 
     return 0;
 }
@@ -92,45 +432,392 @@ unsigned int ht_hash(char *key) {
     return hash;
 }
 
+/*
+ * djb2 carried out in 64 bits: the low 32 bits equal ht_hash, and the full
+ * value feeds the filter, so a filtered lookup still reads the key only once
+ */
+static uint64_t ht_hash64(const char *key) {
+    uint64_t hash = 5381;
+
+    for (size_t i = 0; key[i] != '\0'; i++) {
+        hash = ((hash << 5) + hash) + key[i];
+    }
+
+    return hash;
+}
+
+/*
+ * Replaces the filter with a fresh one sized for the current bucket count and holding every key
+ * Keeps the old filter if memory runs out, since it still has no false negatives
+ */
+static int ht_filter_rebuild(HashTable *ht) {
+    BloomFilter *filter = bf_create((size_t) (ht->capacity_table * MAX_LOAD_FACTOR) + 1, ht->filter_rate);
+
+    if (!filter) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < ht->capacity_table; i++) {
+        for (Entry *current_entry = ht_bucket(ht->buckets, i); current_entry != NULL; current_entry = current_entry->next) {
+            bf_add_hash(filter, ht_hash64(current_entry->key));
+        }
+    }
+
+    bf_free(ht->filter);
+    ht->filter = filter;
+    ht->filter_stale = 0;
+
+    return 0;
+}
+
+/*
+ * Attaches a blocked Bloom filter that answers most misses without touching the buckets
+ * The filter is kept in step by ht_insert, rebuilt on rehash, and rebuilt once
+ * deletions have left a quarter of its design capacity stale
+ */
+int ht_attach_filter(HashTable *ht, double false_positive_rate) {
+    if (!ht || !(false_positive_rate > 0.0 && false_positive_rate < 1.0)) {
+        return -1;
+    }
+
+    double previous_rate = ht->filter_rate;
+    ht->filter_rate = false_positive_rate;
+
+    if (ht_filter_rebuild(ht) != 0) {
+        ht->filter_rate = previous_rate;
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Removes the filter, if any
+ */
+int ht_detach_filter(HashTable *ht) {
+    if (!ht) {
+        return -1;
+    }
+
+    bf_free(ht->filter);
+    ht->filter = NULL;
+    ht->filter_stale = 0;
+
+    return 0;
+}
+
+/*
+ * Makes a freshly filled directory the table's buckets
+ */
+static void ht_install_buckets(HashTable *ht, BucketDirectory *buckets) {
+    ht->buckets = buckets;
+    ht->capacity_table = buckets->capacity;
+
+    // The filter was sized for the old bucket count
+    if (ht->filter) {
+        ht_filter_rebuild(ht);
+    }
+
+    STATS_RESIZE(ht, "hash_table", ht->count * sizeof(Entry));
+}
+
 /*
  * Resizes the table when the load factor (count/capacity) exceeds the threshold (0.7)
  * Re-hashes all existing entries into a new, larger bucket array
+ * While a snapshot shares any bucket, the entries are copied rather than moved
  */
 int ht_rehash(HashTable *ht) {
     if (!ht) {
         return -1;
     }
 
-    size_t old_capacity = ht->capacity_table;
+    BucketDirectory *old_buckets = ht->buckets;
     size_t new_capacity = ht->capacity_table * 2;
-    Entry **new_buckets = calloc(new_capacity, sizeof(Entry *));
+    BucketDirectory *new_buckets = ht_alloc_buckets(&ht->allocator, new_capacity);
 
     if (!new_buckets) {
         return -1;
     }
 
-    // Move every entry from the old buckets to the new ones
-    for (size_t i = 0; i < old_capacity; i++) {
-        Entry *current_entry = ht->buckets[i];
+    if (ht_buckets_shared(old_buckets)) {
+        // Leave the shared chains intact; on failure the table is unchanged
+        for (size_t i = 0; i < ht->capacity_table; i++) {
+            for (Entry *current_entry = ht_bucket(old_buckets, i); current_entry; current_entry = current_entry->next) {
+                Entry *entry = ht_new_entry(&ht->allocator, current_entry->key, current_entry->value);
+
+                if (!entry) {
+                    ht_release_buckets(&ht->allocator, new_buckets);
+                    return -1;
+                }
+
+                Entry **head = ht_bucket_slot(new_buckets, ht_hash(entry->key) % new_capacity);
+
+                entry->next = *head;
+                *head = entry;
+            }
+        }
+
+        ht_release_buckets(&ht->allocator, old_buckets);
+    } else {
+        // Move every entry from the old buckets to the new ones
+        for (size_t i = 0; i < ht->capacity_table; i++) {
+            Entry *current_entry = ht_bucket(old_buckets, i);
+            while (current_entry != NULL) {
+                Entry *next_entry = current_entry->next;
+
+                // Re-calculate the index based on the NEW capacity
+                unsigned int new_index = ht_hash(current_entry->key) % new_capacity;
+                Entry **head = ht_bucket_slot(new_buckets, new_index);
+
+                // Insert at the beginning of the new bucket's list
+                current_entry->next = *head;
+                *head = current_entry;
+
+                current_entry = next_entry;
+            }
+        }
+
+        ht_discard_buckets(&ht->allocator, old_buckets);
+    }
+
+    ht_install_buckets(ht, new_buckets);
+
+    return 0;
+}
+
+// Shared state of one ht_rehash_parallel call
+typedef struct RehashJob {
+    BucketDirectory *old_buckets;
+    BucketDirectory *new_buckets;
+    size_t old_capacity;
+    size_t tasks;
+} RehashJob;
+
+static void ht_clear_chunks_task(void *context, size_t task) {
+    RehashJob *job = context;
+    size_t chunk_count = job->new_buckets->chunk_count;
+
+    ht_clear_chunks(job->new_buckets, task * chunk_count / job->tasks, (task + 1) * chunk_count / job->tasks);
+}
+
+/*
+ * Moves one range of old buckets, each chain in the same order as ht_rehash
+ * Old bucket i only feeds new buckets i and i + old_capacity, so ranges never collide
+ */
+static void ht_rehash_task(void *context, size_t task) {
+    RehashJob *job = context;
+    size_t new_capacity = job->old_capacity * 2;
+    size_t first = task * job->old_capacity / job->tasks;
+    size_t last = (task + 1) * job->old_capacity / job->tasks;
+
+    for (size_t i = first; i < last; i++) {
+        Entry *current_entry = ht_bucket(job->old_buckets, i);
+
         while (current_entry != NULL) {
             Entry *next_entry = current_entry->next;
+            Entry **head = ht_bucket_slot(job->new_buckets, ht_hash(current_entry->key) % new_capacity);
+
+            current_entry->next = *head;
+            *head = current_entry;
+            current_entry = next_entry;
+        }
+    }
+}
 
-            // Re-calculate the index based on the NEW capacity
-            unsigned int new_index = ht_hash(current_entry->key) % new_capacity;
+/*
+ * Same as ht_rehash, with the entries moved by the pool's threads; the table comes
+ * out identical, chain order included, whatever the pool size
+ * Small tables, a NULL pool, and tables a snapshot shares take the ht_rehash path
+ */
+int ht_rehash_parallel(HashTable *ht, ThreadPool *pool) {
+    if (!ht) {
+        return -1;
+    }
+
+    if (!pool || ht->capacity_table < PARALLEL_MIN_BUCKETS || ht_buckets_shared(ht->buckets)) {
+        return ht_rehash(ht);
+    }
 
-            // Insert at the beginning of the new bucket's list
-            current_entry->next = new_buckets[new_index];
-            new_buckets[new_index] = current_entry;
+    RehashJob job = {ht->buckets, ht_alloc_directory(&ht->allocator, ht->capacity_table * 2),
+                     ht->capacity_table, parallel_width(pool)};
+
+    if (!job.new_buckets) {
+        return -1;
+    }
+
+    parallel_for(pool, job.tasks, ht_clear_chunks_task, &job);
+    parallel_for(pool, job.tasks, ht_rehash_task, &job);
+
+    ht_discard_buckets(&ht->allocator, job.old_buckets);
+    ht_install_buckets(ht, job.new_buckets);
+
+    return 0;
+}
+
+// Shared state of one ht_build_parallel call
+typedef struct BuildJob {
+    char **keys;
+    const double *values;
+    size_t count;
+    HashTable *ht;
+    BucketDirectory *buckets;
+    size_t tasks;
+    Entry **lists;          // tasks x tasks: entries of input range s bound for bucket range d, in input order
+    Entry **tails;
+    size_t *inserted;       // Distinct keys linked by each bucket range
+    atomic_int failed;
+} BuildJob;
+
+/*
+ * Returns the bucket range an index falls in; ranges are whole chunks, range d
+ * owning chunks ceil(d * chunks / tasks) up to ceil((d + 1) * chunks / tasks)
+ */
+static size_t ht_build_range(const BuildJob *job, size_t index) {
+    return index / CHUNK_BUCKETS * job->tasks / job->buckets->chunk_count;
+}
+
+/*
+ * Copies one range of the input into entries and sorts them by destination bucket range
+ */
+static void ht_build_entries_task(void *context, size_t task) {
+    BuildJob *job = context;
+    size_t first = task * job->count / job->tasks;
+    size_t last = (task + 1) * job->count / job->tasks;
+
+    for (size_t i = first; i < last && !atomic_load_explicit(&job->failed, memory_order_relaxed); i++) {
+        if (!job->keys[i]) {
+            continue;
+        }
+
+        Entry *entry = ht_new_entry(&job->ht->allocator, job->keys[i], job->values[i]);
+
+        if (!entry) {
+            atomic_store_explicit(&job->failed, 1, memory_order_relaxed);
+            return;
+        }
+
+        size_t list = task * job->tasks + ht_build_range(job, ht_hash(entry->key) % job->buckets->capacity);
+
+        if (job->tails[list]) {
+            job->tails[list]->next = entry;
+        } else {
+            job->lists[list] = entry;
+        }
+        job->tails[list] = entry;
+    }
+}
+
+/*
+ * Links every entry bound for one bucket range, in input order, as a loop of ht_insert calls would:
+ * a repeated key keeps its first entry and takes the last value
+ */
+static void ht_build_link_task(void *context, size_t task) {
+    BuildJob *job = context;
+    size_t chunk_count = job->buckets->chunk_count;
+    size_t inserted = 0;
+
+    ht_clear_chunks(job->buckets, (task * chunk_count + job->tasks - 1) / job->tasks,
+                    ((task + 1) * chunk_count + job->tasks - 1) / job->tasks);
+
+    for (size_t source = 0; source < job->tasks; source++) {
+        Entry *current_entry = job->lists[source * job->tasks + task];
+
+        while (current_entry != NULL) {
+            Entry *next_entry = current_entry->next;
+            Entry **head = ht_bucket_slot(job->buckets, ht_hash(current_entry->key) % job->buckets->capacity);
+            Entry *existing = *head;
+
+            while (existing && strcmp(existing->key, current_entry->key) != 0) {
+                existing = existing->next;
+            }
+
+            if (existing) {
+                existing->value = current_entry->value;
+                ht_free_entry(&job->ht->allocator, current_entry);
+            } else {
+                current_entry->next = *head;
+                *head = current_entry;
+                inserted++;
+            }
 
             current_entry = next_entry;
         }
     }
 
-    free(ht->buckets);
-    ht->buckets = new_buckets;
-    ht->capacity_table = new_capacity;
+    job->inserted[task] = inserted;
+}
 
-    return 0;
+/*
+ * Builds a table holding keys[i] -> values[i] for every i, sized up front so it never rehashes
+ * The pool's threads copy the keys and link the entries; the table is the same for
+ * any pool size, or a NULL pool, and holds what a loop of ht_insert calls would store
+ * NULL keys are skipped. Returns NULL if memory runs out
+ */
+HashTable *ht_build_parallel(char **keys, const double *values, size_t count, ThreadPool *pool) {
+    if ((!keys || !values) && count > 0) {
+        return NULL;
+    }
+
+    HashTable *ht = ht_create();
+
+    if (!ht) {
+        return NULL;
+    }
+
+    size_t capacity = ht->capacity_table;
+
+    while ((double) count / capacity > MAX_LOAD_FACTOR) {
+        capacity *= 2;
+    }
+
+    size_t tasks = parallel_width(pool);
+    BuildJob job = {keys, values, count, ht, ht_alloc_directory(&ht->allocator, capacity), tasks,
+                    calloc(tasks * tasks, sizeof(Entry *)), calloc(tasks * tasks, sizeof(Entry *)),
+                    calloc(tasks, sizeof(size_t)), 0};
+
+    if (!job.buckets || !job.lists || !job.tails || !job.inserted) {
+        if (job.buckets) {
+            ht_discard_buckets(&ht->allocator, job.buckets);
+        }
+        free(job.lists);
+        free(job.tails);
+        free(job.inserted);
+        ht_free(ht);
+        return NULL;
+    }
+
+    parallel_for(pool, tasks, ht_build_entries_task, &job);
+
+    if (atomic_load(&job.failed)) {
+        for (size_t i = 0; i < tasks * tasks; i++) {
+            while (job.lists[i]) {
+                Entry *next_entry = job.lists[i]->next;
+                ht_free_entry(&ht->allocator, job.lists[i]);
+                job.lists[i] = next_entry;
+            }
+        }
+        ht_discard_buckets(&ht->allocator, job.buckets);
+        free(job.lists);
+        free(job.tails);
+        free(job.inserted);
+        ht_free(ht);
+        return NULL;
+    }
+
+    parallel_for(pool, tasks, ht_build_link_task, &job);
+
+    ht_release_buckets(&ht->allocator, ht->buckets);
+    ht->count = 0;
+    for (size_t i = 0; i < tasks; i++) {
+        ht->count += job.inserted[i];
+    }
+    ht_install_buckets(ht, job.buckets);
+
+    free(job.lists);
+    free(job.tails);
+    free(job.inserted);
+
+    return ht;
 }
 
 /*
@@ -142,39 +829,59 @@ void ht_insert(HashTable *ht, char *key, double value) {
         return;
     }
 
+    STATS_TIMER_START();
+
     // Check load factor: if > 70%, double the table size
-    if ((double) ht->count / ht->capacity_table > 0.7) {
+    if ((double) ht->count / ht->capacity_table > MAX_LOAD_FACTOR) {
         ht_rehash(ht);
     }
 
     unsigned int hash_value = ht_hash(key);
     size_t index = (size_t) hash_value % ht->capacity_table;
-    Entry *current_entry = ht->buckets[index];
+    Entry **head = ht_bucket_for_write(ht, index);
+
+    if (!head) {
+        STATS_TIMER_STOP(ht);
+        return;
+    }
+
+    Entry *current_entry = *head;
+    size_t probes = 0;
 
     // Check if key already exists (update case)
     while (current_entry != NULL) {
+        probes++;
         if (strcmp(current_entry->key, key) == 0) {
             current_entry->value = value;
+            STATS_PROBE(ht, probes);
+            STATS_COUNT(ht, inserts);
+            STATS_TIMER_STOP(ht);
             return;
         }
         current_entry = current_entry->next;
     }
 
-    // Key doesn't exist, create a new entry (insertion case)
-    Entry *new_entry = malloc(sizeof(Entry));
-    if (!new_entry) return;
+    STATS_PROBE(ht, probes);
 
-    new_entry->key = strdup(key);   // Duplicate the string to manage its own memory
-    if (!new_entry->key) {
-        free(new_entry);
+    // Key doesn't exist, create a new entry (insertion case)
+    Entry *new_entry = ht_new_entry(&ht->allocator, key, value);
+    if (!new_entry) {
+        STATS_TIMER_STOP(ht);
         return;
     }
 
-    new_entry->value = value;
     // Push to the front of the linked list (head insertion)
-    new_entry->next = ht->buckets[index];
-    ht->buckets[index] = new_entry;
+    new_entry->next = *head;
+    *head = new_entry;
     ht->count++;
+
+    if (ht->filter) {
+        bf_add_hash(ht->filter, ht_hash64(key));
+    }
+
+    STATS_COUNT(ht, inserts);
+    STATS_SIZE(ht, ht->count);
+    STATS_TIMER_STOP(ht);
 }
 
 /*
@@ -185,32 +892,57 @@ int ht_delete(HashTable *ht, char *key) {
         return -1;
     }
 
+    if (ht->filter && !bf_contains_hash(ht->filter, ht_hash64(key))) {
+        return -1;
+    }
+
+    STATS_TIMER_START();
+
     size_t index = ht_hash(key) % ht->capacity_table;
+    Entry *current_entry = ht_bucket(ht->buckets, index);
+    size_t probes = 0;
 
-    Entry *current_entry = ht->buckets[index];
-    Entry *previous_entry = NULL;
+    // Find the key before unsharing anything, so a miss after a snapshot copies nothing
+    while (current_entry != NULL && strcmp(current_entry->key, key) != 0) {
+        probes++;
+        current_entry = current_entry->next;
+    }
 
-    while (current_entry != NULL) {
-        if (strcmp(current_entry->key, key) == 0) {
+    STATS_PROBE(ht, probes + (current_entry != NULL));
 
-            // Unlink the node from the chain
-            if (previous_entry == NULL) {
-                ht->buckets[index] = current_entry->next; // Node was the head
-            } else {
-                previous_entry->next = current_entry->next; // Node was in the middle/end
-            }
+    if (current_entry == NULL) {
+        STATS_TIMER_STOP(ht);
+        return -1;
+    }
 
-            free(current_entry->key);
-            free(current_entry);
+    // Unsharing may copy the chain, so the node is found again by its position
+    Entry **link = ht_bucket_for_write(ht, index);
 
-            ht->count--;
-            return 0;
-        }
-        previous_entry = current_entry;
-        current_entry = current_entry->next;
+    if (!link) {
+        STATS_TIMER_STOP(ht);
+        return -1;
     }
 
-    return -1;  // Key not found
+    for (size_t i = 0; i < probes; i++) {
+        link = &(*link)->next;
+    }
+
+    // Unlink the node from the chain
+    current_entry = *link;
+    *link = current_entry->next;
+    ht_free_entry(&ht->allocator, current_entry);
+
+    ht->count--;
+
+    // A Bloom filter cannot drop a key, so it is rebuilt once enough of it is stale
+    if (ht->filter && ++ht->filter_stale > ht->capacity_table * MAX_LOAD_FACTOR / 4) {
+        ht_filter_rebuild(ht);
+    }
+
+    STATS_COUNT(ht, removals);
+    STATS_SIZE(ht, ht->count);
+    STATS_TIMER_STOP(ht);
+    return 0;
 }
 
 /*
@@ -221,17 +953,39 @@ double ht_search(HashTable *ht, char *key) {
         return NAN;
     }
 
-    size_t index = ht_hash(key) % ht->capacity_table;
+    STATS_TIMER_START();
+    STATS_COUNT(ht, lookups);
+
+    uint64_t hash = ht_hash64(key);
+    size_t index = (unsigned int) hash % ht->capacity_table;
+
+    // Most misses end here after one cache line, without comparing keys; the bucket
+    // is prefetched first so a hit's filter and bucket misses overlap
+    if (ht->filter) {
+        __builtin_prefetch(&ht->buckets->chunks[index / CHUNK_BUCKETS]->heads[index % CHUNK_BUCKETS]);
 
-    Entry *current_entry = ht->buckets[index];
+        if (!bf_contains_hash(ht->filter, hash)) {
+            STATS_TIMER_STOP(ht);
+            return NAN;
+        }
+    }
+
+    Entry *current_entry = ht_bucket(ht->buckets, index);
+    size_t probes = 0;
 
     while (current_entry != NULL) {
+        probes++;
         if (strcmp(current_entry->key, key) == 0) {
+            STATS_PROBE(ht, probes);
+            STATS_TIMER_STOP(ht);
             return current_entry->value;
         }
         current_entry = current_entry->next;
     }
 
+    STATS_PROBE(ht, probes);
+    STATS_TIMER_STOP(ht);
+
     return NAN;
 }
 
@@ -241,7 +995,7 @@ double ht_search(HashTable *ht, char *key) {
 void ht_print(HashTable *ht) {
     for (size_t i = 0; i < ht->capacity_table; i++) {
         printf("Bucket %zu: ", i);
-        Entry *current_entry = ht->buckets[i];
+        Entry *current_entry = ht_bucket(ht->buckets, i);
         while (current_entry) {
             printf("[%s: %.2f] -> ", current_entry->key, current_entry->value);
             current_entry = current_entry->next;
@@ -249,3 +1003,85 @@ void ht_print(HashTable *ht) {
         printf("NULL\n");
     }
 }
+
+/*
+ * Copies the table's counters into *out
+ * Returns -1 if the library was built without LDS_STATS
+ */
+int ht_stats(HashTable *ht, DsStats *out) {
+    if (!ht || !out) {
+        return -1;
+    }
+
+    return STATS_COPY(ht, out);
+}
+
+/*
+ * Returns a read-only view of the table as it is now, in O(1)
+ * The view shares the table's buckets; the table copies a chunk of them, with its
+ * entries, the first time it writes to that chunk after the snapshot, so neither
+ * side ever waits for the other
+ * Must be called from the thread that writes the table; the snapshot may then be
+ * read and freed from any thread, with the table's allocator freeing what it alone holds
+ */
+HashTableSnapshot *ht_snapshot(HashTable *ht) {
+    if (!ht) {
+        return NULL;
+    }
+
+    HashTableSnapshot *snapshot = allocator_alloc(&ht->allocator, sizeof(HashTableSnapshot));
+
+    if (!snapshot) {
+        return NULL;
+    }
+
+    atomic_fetch_add_explicit(&ht->buckets->refs, 1, memory_order_relaxed);
+    snapshot->buckets = ht->buckets;
+    snapshot->count = ht->count;
+    snapshot->allocator = ht->allocator;
+
+    return snapshot;
+}
+
+/*
+ * Searches a snapshot for a key and returns its value at the time of the snapshot
+ * Returns NAN if the key was not present
+ */
+double hts_search(HashTableSnapshot *snapshot, char *key) {
+    if (!snapshot || !key) {
+        return NAN;
+    }
+
+    size_t index = ht_hash(key) % snapshot->buckets->capacity;
+
+    for (Entry *current_entry = ht_bucket(snapshot->buckets, index); current_entry; current_entry = current_entry->next) {
+        if (strcmp(current_entry->key, key) == 0) {
+            return current_entry->value;
+        }
+    }
+
+    return NAN;
+}
+
+/*
+ * Returns the number of keys the table held when the snapshot was taken
+ */
+size_t hts_size(HashTableSnapshot *snapshot) {
+    return snapshot ? snapshot->count : 0;
+}
+
+/*
+ * Drops the snapshot, freeing any chunks the table has since replaced
+ */
+int hts_free(HashTableSnapshot *snapshot) {
+    if (!snapshot) {
+        return -1;
+    }
+
+    Allocator allocator = snapshot->allocator;
+
+    ht_release_buckets(&allocator, snapshot->buckets);
+    allocator_free(&allocator, snapshot, sizeof(HashTableSnapshot));
+
+    return 0;
+}
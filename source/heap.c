@@ -1,29 +1,135 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-#define DEFAULT_CAPACITY 100    // The starting size for the dynamic heap array
+#include "functions.h"
+#include "growth_internal.h"
+#include "parallel_internal.h"
+#include "serialize_internal.h"
+#include "simd_kernels.h"
+#include "stats_internal.h"
+
+#define PARALLEL_MIN_LEVEL 16384    // Heap levels with fewer parents are sifted on the calling thread
+#define SORT_RUN 65536              // Elements h_sort_parallel heapsorts at a time, 512 KiB to stay in L2
 
 // Structure for a max-heap using a contiguous array
 typedef struct Heap {
     double *data;       // Array storing the heap elements
     size_t size;        // Current number of elements
     size_t capacity;    // Total allocated space
+    GrowthPolicy policy;    // Initial capacity, growth factor and shrink threshold
+    Allocator allocator;    // Source of the heap and its array
+    STATS_FIELD             // Operation counters, only present when built with LDS_STATS
 } Heap;
 
+// A min-heap shares the array layout but is only ever touched by the min-ordered routines
+typedef struct MinHeap {
+    Heap heap;
+} MinHeap;
+
+/*
+ * Generates the sift routines for one heap ordering
+ * HIGHER(a, b) is true when a belongs above b, so every variant gets its own
+ * copy with the comparison inlined instead of calling through a function pointer
+ */
+#define HEAP_DEFINE_ORDER(name, HIGHER)                                         \
+    static inline void name##_sift_up(double *data, size_t i) {                 \
+        double value = data[i];                                                 \
+        /* Shift lower parents down, then drop the value into the gap */       \
+        while (i > 0) {                                                         \
+            size_t parent = (i - 1) / 2;                                        \
+            if (!HIGHER(value, data[parent])) {                                 \
+                break;                                                          \
+            }                                                                   \
+            data[i] = data[parent];                                             \
+            i = parent;                                                         \
+        }                                                                       \
+        data[i] = value;                                                        \
+    }                                                                           \
+                                                                                \
+    static inline void name##_sift_down(double *data, size_t size, size_t i) {  \
+        double value = data[i];                                                 \
+        /* Pull the higher child up until the value fits */                    \
+        while (2 * i + 1 < size) {                                              \
+            size_t child = 2 * i + 1;                                           \
+            if (child + 1 < size && HIGHER(data[child + 1], data[child])) {     \
+                child++;                                                        \
+            }                                                                   \
+            if (!HIGHER(data[child], value)) {                                  \
+                break;                                                          \
+            }                                                                   \
+            data[i] = data[child];                                              \
+            i = child;                                                          \
+        }                                                                       \
+        data[i] = value;                                                        \
+    }
+
+#define HEAP_MAX_HIGHER(a, b) ((a) > (b))
+#define HEAP_MIN_HIGHER(a, b) ((a) < (b))
+
+HEAP_DEFINE_ORDER(h_max, HEAP_MAX_HIGHER)
+HEAP_DEFINE_ORDER(h_min, HEAP_MIN_HIGHER)
+
+/*
+ * Allocates the internal array of an embedded heap
+ */
+static int h_init(Heap *h, const GrowthPolicy *policy, const Allocator *allocator) {
+    h->policy = *policy;
+    h->allocator = *allocator;
+    h->data = allocator_alloc(allocator, policy->initial_capacity * sizeof(double));
+
+    if (!h->data) {
+        return -1;
+    }
+
+    h->size = 0;
+    h->capacity = policy->initial_capacity;
+    STATS_INIT(h);
+
+    return 0;
+}
+
 /*
  * Creates an empty heap with default capacity
  */
 Heap *h_create() {
-    Heap *h = malloc(sizeof(Heap));
+    return h_create_with_allocator(NULL);
+}
+
+/*
+ * Same as h_create, but the heap and its array come from the given allocator
+ * Passing NULL selects the default malloc-based allocator
+ */
+Heap *h_create_with_allocator(const Allocator *allocator) {
+    return h_create_with_policy(NULL, allocator);
+}
+
+/*
+ * Same as h_create_with_allocator, but sizing follows the given growth policy
+ * Passing NULL selects the defaults; returns NULL if the policy is invalid
+ */
+Heap *h_create_with_policy(const GrowthPolicy *policy, const Allocator *allocator) {
+    GrowthPolicy resolved;
+
+    if (growth_policy_resolve(&resolved, policy) != 0) {
+        return NULL;
+    }
+
+    if (!allocator) {
+        allocator = allocator_default();
+    }
+
+    Heap *h = allocator_alloc(allocator, sizeof(Heap));
 
     if (!h) {
         return NULL;
     }
 
-    h->data = malloc(DEFAULT_CAPACITY * sizeof(double));
-    h->size = 0;
-    h->capacity = DEFAULT_CAPACITY;
+    if (h_init(h, &resolved, allocator) != 0) {
+        allocator_free(allocator, h, sizeof(Heap));
+        return NULL;
+    }
 
     return h;
 }
@@ -36,22 +142,25 @@ int h_free(Heap *h) {
         return -1;
     }
 
-    free(h->data);
-    free(h);
+    STATS_FREE(h, "heap");
+
+    Allocator allocator = h->allocator;
+
+    allocator_free(&allocator, h->data, h->capacity * sizeof(double));
+    allocator_free(&allocator, h, sizeof(Heap));
     return 0;
 }
 
 /*
- * Resizes the internal array when capacity is reached
+ * Grows or shrinks the internal array to new_capacity
  */
-int h_resize(Heap *h) {
-    if (!h) {
+int h_resize(Heap *h, size_t new_capacity) {
+    if (!h || new_capacity < h->size || new_capacity == 0) {
         return -1;
     }
 
-    size_t new_capacity = h->capacity * 2;
-
-    double *buffer = realloc(h->data, new_capacity * sizeof(double));
+    double *buffer = allocator_realloc(&h->allocator, h->data,
+                                       h->capacity * sizeof(double), new_capacity * sizeof(double));
 
     if (!buffer) {
         return -1;
@@ -60,41 +169,32 @@ int h_resize(Heap *h) {
     h->data = buffer;
     h->capacity = new_capacity;
 
+    STATS_RESIZE(h, "heap", h->size * sizeof(double));
+
     return 0;
 }
 
+/*
+ * Gives memory back once the heap has drained well below capacity
+ */
+static void h_shrink_if_sparse(Heap *h) {
+    size_t target = growth_shrink_target(&h->policy, h->size, h->capacity);
+
+    if (target) {
+        h_resize(h, target);
+    }
+}
+
 /*
  * Maintains the max-heap property by "sifting down" an element
  * Used after removing the root to restore order
  */
 void h_max_heapify(Heap *h, size_t i) {
-    if (!h || h->size == 0) {
+    if (!h || i >= h->size) {
         return;
     }
 
-    // Binary tree mapping in an array
-    size_t left = 2 * i + 1;
-    size_t right = 2 * i + 2;
-    size_t largest = i;
-
-    // Compare with left child
-    if (left < h->size && h->data[left] > h->data[largest]) {
-        largest = left;
-    }
-
-    // Compare with right child
-    if (right < h->size && h->data[right] > h->data[largest]) {
-        largest = right;
-    }
-
-    // If a child is larger, swap and continue heapifying down
-    if (largest != i) {
-        double buffer = h->data[i];
-        h->data[i] = h->data[largest];
-        h->data[largest] = buffer;
-
-        h_max_heapify(h, largest);
-    }
+    h_max_sift_down(h->data, h->size, i);
 }
 
 /*
@@ -106,37 +206,35 @@ void h_insert(Heap *h, double value) {
         return;
     }
 
+    STATS_TIMER_START();
+
     if (h->size >= h->capacity) {
-        if (h_resize(h) != 0) {
+        if (h_resize(h, growth_next(&h->policy, h->capacity)) != 0) {
             return;
         }
     }
 
-    // Place a new value at the first available leaf position
-    size_t i = h->size;
-    h->data[i] = value;
+    // Place a new value at the first available leaf position and bubble it up
+    h->data[h->size] = value;
+    h_max_sift_up(h->data, h->size);
     h->size++;
 
-    // Bubble up: Compare with parent and swap if larger
-    while (i > 0) {
-        size_t parent = (i - 1) / 2;
-        if (h->data[i] > h->data[parent]) {
-            double buffer = h->data[i];
-            h->data[i] = h->data[parent];
-            h->data[parent] = buffer;
-            i = parent;
-        }
-        else {
-            break;  // Heap property is restored
-        }
-    }
+    STATS_COUNT(h, inserts);
+    STATS_SIZE(h, h->size);
+    STATS_TIMER_STOP(h);
 }
 
 /*
  * Returns the maximum value (root) without removing it
  */
 double h_peek(Heap *h) {
-    return (h && h->size > 0) ? h->data[0] : NAN;
+    if (!h || h->size == 0) {
+        return NAN;
+    }
+
+    STATS_COUNT(h, lookups);
+
+    return h->data[0];
 }
 
 /*
@@ -148,6 +246,8 @@ double h_pop_max(Heap *h) {
         return NAN;
     }
 
+    STATS_TIMER_START();
+
     double root = h->data[0];
 
     // Replace root with the last element in the array
@@ -156,6 +256,499 @@ double h_pop_max(Heap *h) {
 
     // Restore the heap property from the root down
     h_max_heapify(h, 0);
+    h_shrink_if_sparse(h);
+
+    STATS_COUNT(h, removals);
+    STATS_SIZE(h, h->size);
+    STATS_TIMER_STOP(h);
 
     return root;
 }
+
+/*
+ * Returns the number of elements in the heap
+ */
+size_t h_size(Heap *h) {
+    return h ? h->size : 0;
+}
+
+/*
+ * Counts the elements strictly greater than threshold without popping them
+ */
+size_t h_count_above(Heap *h, double threshold) {
+    if (!h) {
+        return 0;
+    }
+
+    STATS_COUNT(h, lookups);
+
+    // A full vector scan beats pruning subtrees by the heap order, which would jump around the array
+    return simd_count_above(h->data, h->size, threshold);
+}
+
+// Shared state of one h_build_from_array call
+typedef struct HeapBuildJob {
+    double *data;
+    const double *values;   // Source of the copy into data
+    size_t size;
+    size_t first;           // Parents [first, last) of the level being sifted
+    size_t last;
+    size_t tasks;
+} HeapBuildJob;
+
+static void h_copy_task(void *context, size_t task) {
+    HeapBuildJob *job = context;
+    size_t first = task * job->size / job->tasks;
+    size_t last = (task + 1) * job->size / job->tasks;
+
+    memcpy(job->data + first, job->values + first, (last - first) * sizeof(double));
+}
+
+/*
+ * Sifts down one slice of a level; the subtrees below one level are disjoint
+ */
+static void h_sift_level_task(void *context, size_t task) {
+    HeapBuildJob *job = context;
+    size_t width = job->last - job->first;
+    size_t first = job->first + task * width / job->tasks;
+    size_t last = job->first + (task + 1) * width / job->tasks;
+
+    for (size_t i = last; i-- > first;) {
+        h_max_sift_down(job->data, job->size, i);
+    }
+}
+
+/*
+ * Creates a heap holding a copy of values in O(n) with Floyd's bottom-up heapify,
+ * instead of the O(n log n) of count h_insert calls
+ * With a pool, each level of parents is split across its threads once the level is
+ * wide enough; the array comes out exactly as with a NULL pool
+ */
+Heap *h_build_from_array(const double *values, size_t count, ThreadPool *pool) {
+    if (!values && count > 0) {
+        return NULL;
+    }
+
+    GrowthPolicy policy = {count, 0.0, 0.0};
+    Heap *h = h_create_with_policy(&policy, NULL);
+
+    if (!h) {
+        return NULL;
+    }
+
+    HeapBuildJob job = {h->data, values, count, 0, 0, parallel_width(pool)};
+    parallel_for(pool, job.tasks, h_copy_task, &job);
+    h->size = count;
+
+    // Level l holds nodes [2^l - 1, 2^(l+1) - 1); start at the deepest one with a parent
+    size_t parents = count / 2;
+    size_t level = 1;
+
+    while (level * 2 - 1 < parents) {
+        level *= 2;
+    }
+
+    for (; parents > 0 && level > 0; level /= 2) {
+        job.first = level - 1;
+        job.last = level * 2 - 1 < parents ? level * 2 - 1 : parents;
+
+        if (job.last - job.first < PARALLEL_MIN_LEVEL) {
+            for (size_t i = job.last; i-- > job.first;) {
+                h_max_sift_down(h->data, count, i);
+            }
+        } else {
+            parallel_for(pool, job.tasks, h_sift_level_task, &job);
+        }
+    }
+
+    STATS_SIZE(h, count);
+
+    return h;
+}
+
+// Shared state of one h_sort_parallel merge pass
+typedef struct HeapSortJob {
+    double *source;
+    double *target;
+    size_t count;
+    size_t width;           // Length of the sorted runs being merged in pairs
+    size_t pieces;          // Tasks each pair's merge is split into
+} HeapSortJob;
+
+/*
+ * Heapsorts one SORT_RUN slice of the source in place into ascending order
+ */
+static void h_sort_run_task(void *context, size_t task) {
+    HeapSortJob *job = context;
+    size_t first = task * SORT_RUN;
+    size_t length = job->count - first < SORT_RUN ? job->count - first : SORT_RUN;
+    double *run = job->source + first;
+
+    for (size_t i = length / 2; i-- > 0;) {
+        h_max_sift_down(run, length, i);
+    }
+
+    // Move the root behind the shrinking heap, largest first
+    for (size_t end = length - 1; end > 0; end--) {
+        double top = run[0];
+        run[0] = run[end];
+        run[end] = top;
+        h_max_sift_down(run, end, 0);
+    }
+}
+
+/*
+ * Returns how many elements of a are among the first k outputs of a stable merge
+ * of a and b, where a wins ties; found by binary search along the merge path
+ */
+static size_t h_merge_split(const double *a, size_t a_length, const double *b, size_t b_length, size_t k) {
+    size_t low = k > b_length ? k - b_length : 0;
+    size_t high = k < a_length ? k : a_length;
+
+    while (low < high) {
+        size_t i = low + (high - low) / 2;
+
+        if (k - i > 0 && a[i] <= b[k - i - 1]) {
+            low = i + 1;
+        } else {
+            high = i;
+        }
+    }
+
+    return low;
+}
+
+/*
+ * Writes one piece of the merge of two adjacent runs; pieces are cut by output
+ * position, so the merged result does not depend on how many there are
+ */
+static void h_merge_task(void *context, size_t task) {
+    HeapSortJob *job = context;
+    size_t pair = task / job->pieces;
+    size_t piece = task % job->pieces;
+    size_t first = pair * 2 * job->width;
+    size_t middle = job->count - first < job->width ? job->count : first + job->width;
+    size_t last = job->count - middle < job->width ? job->count : middle + job->width;
+    const double *a = job->source + first;
+    const double *b = job->source + middle;
+    size_t a_length = middle - first;
+    size_t b_length = last - middle;
+    size_t begin = piece * (last - first) / job->pieces;
+    size_t end = (piece + 1) * (last - first) / job->pieces;
+
+    size_t i = h_merge_split(a, a_length, b, b_length, begin);
+    size_t j = begin - i;
+    size_t i_end = h_merge_split(a, a_length, b, b_length, end);
+    size_t j_end = end - i_end;
+    double *out = job->target + first + begin;
+
+    while (i < i_end && j < j_end) {
+        *out++ = a[i] <= b[j] ? a[i++] : b[j++];
+    }
+    while (i < i_end) {
+        *out++ = a[i++];
+    }
+    while (j < j_end) {
+        *out++ = b[j++];
+    }
+}
+
+/*
+ * Sorts values into ascending order
+ * Runs of SORT_RUN elements are heapsorted while they fit in cache, then merged in
+ * pairs; a pool sorts runs and merge pieces on its threads. Run boundaries depend
+ * only on count and merges are stable, so the output is identical, bit for bit,
+ * for any pool size. values must not contain NaN
+ * Returns -1, leaving values untouched, if the merge buffer cannot be allocated
+ */
+int h_sort_parallel(double *values, size_t count, ThreadPool *pool) {
+    if (!values && count > 0) {
+        return -1;
+    }
+
+    double *scratch = NULL;
+
+    if (count > SORT_RUN) {
+        scratch = malloc(count * sizeof(double));
+
+        if (!scratch) {
+            return -1;
+        }
+    }
+
+    size_t tasks = parallel_width(pool);
+    HeapSortJob job = {values, scratch, count, SORT_RUN, 1};
+
+    parallel_for(pool, (count + SORT_RUN - 1) / SORT_RUN, h_sort_run_task, &job);
+
+    for (; job.width < count; job.width *= 2) {
+        size_t pairs = (count + 2 * job.width - 1) / (2 * job.width);
+
+        // Late passes have few pairs, so each merge is split to keep every thread busy
+        job.pieces = tasks > pairs ? (tasks + pairs - 1) / pairs : 1;
+        parallel_for(pool, pairs * job.pieces, h_merge_task, &job);
+
+        double *swap = job.source;
+        job.source = job.target;
+        job.target = swap;
+    }
+
+    if (job.source != values) {
+        HeapBuildJob copy = {values, job.source, count, 0, 0, tasks};
+        parallel_for(pool, tasks, h_copy_task, &copy);
+    }
+
+    free(scratch);
+
+    return 0;
+}
+
+/*
+ * Creates an empty min-heap with default capacity
+ */
+MinHeap *mh_create() {
+    return mh_create_with_allocator(NULL);
+}
+
+/*
+ * Same as mh_create, but the heap and its array come from the given allocator
+ * Passing NULL selects the default malloc-based allocator
+ */
+MinHeap *mh_create_with_allocator(const Allocator *allocator) {
+    return mh_create_with_policy(NULL, allocator);
+}
+
+/*
+ * Same as mh_create_with_allocator, but sizing follows the given growth policy
+ * Passing NULL selects the defaults; returns NULL if the policy is invalid
+ */
+MinHeap *mh_create_with_policy(const GrowthPolicy *policy, const Allocator *allocator) {
+    GrowthPolicy resolved;
+
+    if (growth_policy_resolve(&resolved, policy) != 0) {
+        return NULL;
+    }
+
+    if (!allocator) {
+        allocator = allocator_default();
+    }
+
+    MinHeap *mh = allocator_alloc(allocator, sizeof(MinHeap));
+
+    if (!mh) {
+        return NULL;
+    }
+
+    if (h_init(&mh->heap, &resolved, allocator) != 0) {
+        allocator_free(allocator, mh, sizeof(MinHeap));
+        return NULL;
+    }
+
+    return mh;
+}
+
+/*
+ * Frees the memory allocated for the min-heap array and structure
+ */
+int mh_free(MinHeap *mh) {
+    if (!mh) {
+        return -1;
+    }
+
+    STATS_FREE(&mh->heap, "min_heap");
+
+    Allocator allocator = mh->heap.allocator;
+
+    allocator_free(&allocator, mh->heap.data, mh->heap.capacity * sizeof(double));
+    allocator_free(&allocator, mh, sizeof(MinHeap));
+    return 0;
+}
+
+/*
+ * Inserts a new value into the min-heap
+ */
+void mh_insert(MinHeap *mh, double value) {
+    if (!mh) {
+        return;
+    }
+
+    Heap *h = &mh->heap;
+
+    STATS_TIMER_START();
+
+    if (h->size >= h->capacity) {
+        if (h_resize(h, growth_next(&h->policy, h->capacity)) != 0) {
+            return;
+        }
+    }
+
+    h->data[h->size] = value;
+    h_min_sift_up(h->data, h->size);
+    h->size++;
+
+    STATS_COUNT(h, inserts);
+    STATS_SIZE(h, h->size);
+    STATS_TIMER_STOP(h);
+}
+
+/*
+ * Returns the minimum value (root) without removing it
+ */
+double mh_peek(MinHeap *mh) {
+    if (!mh || mh->heap.size == 0) {
+        return NAN;
+    }
+
+    STATS_COUNT(&mh->heap, lookups);
+
+    return mh->heap.data[0];
+}
+
+/*
+ * Removes and returns the minimum value
+ */
+double mh_pop_min(MinHeap *mh) {
+    if (!mh || mh->heap.size == 0) {
+        return NAN;
+    }
+
+    Heap *h = &mh->heap;
+
+    STATS_TIMER_START();
+
+    double root = h->data[0];
+
+    h->data[0] = h->data[h->size - 1];
+    h->size--;
+
+    h_min_sift_down(h->data, h->size, 0);
+    h_shrink_if_sparse(h);
+
+    STATS_COUNT(h, removals);
+    STATS_SIZE(h, h->size);
+    STATS_TIMER_STOP(h);
+
+    return root;
+}
+
+/*
+ * Copies the heap's counters into *out
+ * Returns -1 if the library was built without LDS_STATS
+ */
+int h_stats(Heap *h, DsStats *out) {
+    if (!h || !out) {
+        return -1;
+    }
+
+    return STATS_COPY(h, out);
+}
+
+/*
+ * Copies the min-heap's counters into *out
+ * Returns -1 if the library was built without LDS_STATS
+ */
+int mh_stats(MinHeap *mh, DsStats *out) {
+    if (!mh || !out) {
+        return -1;
+    }
+
+    return STATS_COPY(&mh->heap, out);
+}
+
+/*
+ * Writes the heap's array to fd as a binary image with a single writev
+ * The array is written in heap order, so loading it needs no re-heapify
+ */
+int h_write(Heap *h, int fd) {
+    if (!h) {
+        return -1;
+    }
+
+    return serial_write_array(fd, SERIAL_HEAP, h->data, h->size, NULL, 0);
+}
+
+/*
+ * Loads an image written by h_write straight into an array sized to hold it
+ * The array is only checked in one sequential pass, never rebuilt
+ * Returns NULL if the image is malformed, truncated or not max-heap ordered
+ */
+Heap *h_read(int fd) {
+    size_t count;
+
+    if (serial_read_header(fd, SERIAL_HEAP, &count) != 0) {
+        return NULL;
+    }
+
+    GrowthPolicy policy = {count, 0.0, 0.0};
+    Heap *h = h_create_with_policy(&policy, NULL);
+
+    if (!h) {
+        return NULL;
+    }
+
+    if (serial_read_doubles(fd, h->data, count) != 0) {
+        h_free(h);
+        return NULL;
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        if (HEAP_MAX_HIGHER(h->data[i], h->data[(i - 1) / 2])) {
+            h_free(h);
+            return NULL;
+        }
+    }
+
+    h->size = count;
+    STATS_SIZE(h, count);
+
+    return h;
+}
+
+/*
+ * Writes the min-heap's array to fd as a binary image with a single writev
+ */
+int mh_write(MinHeap *mh, int fd) {
+    if (!mh) {
+        return -1;
+    }
+
+    return serial_write_array(fd, SERIAL_MIN_HEAP, mh->heap.data, mh->heap.size, NULL, 0);
+}
+
+/*
+ * Loads an image written by mh_write without re-heapifying it
+ * Returns NULL if the image is malformed, truncated or not min-heap ordered
+ */
+MinHeap *mh_read(int fd) {
+    size_t count;
+
+    if (serial_read_header(fd, SERIAL_MIN_HEAP, &count) != 0) {
+        return NULL;
+    }
+
+    GrowthPolicy policy = {count, 0.0, 0.0};
+    MinHeap *mh = mh_create_with_policy(&policy, NULL);
+
+    if (!mh) {
+        return NULL;
+    }
+
+    Heap *h = &mh->heap;
+
+    if (serial_read_doubles(fd, h->data, count) != 0) {
+        mh_free(mh);
+        return NULL;
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        if (HEAP_MIN_HIGHER(h->data[i], h->data[(i - 1) / 2])) {
+            mh_free(mh);
+            return NULL;
+        }
+    }
+
+    h->size = count;
+    STATS_SIZE(h, count);
+
+    return mh;
+}
@@ -0,0 +1,373 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "functions.h"
+
+#define DEFAULT_CAPACITY 100    // The starting number of handles for the indexed heap
+
+// A handle is a slot index in its low bits and that slot's generation above them
+#if SIZE_MAX > 0xFFFFFFFFu
+#define IH_SLOT_BITS 32
+#else
+#define IH_SLOT_BITS 24
+#endif
+#define IH_SLOT_MASK (((size_t) 1 << IH_SLOT_BITS) - 1)
+#define IH_GENERATION_MASK (SIZE_MAX >> IH_SLOT_BITS)
+
+/*
+ * Structure for an indexed max-heap
+ * The heap array stores slots instead of values, and a position map tracks
+ * where each slot currently sits so priorities can be changed in place
+ * Slots are recycled; the generation a handle carries tells a slot's current
+ * element apart from earlier ones, so a stale handle is rejected
+ */
+typedef struct IndexedHeap {
+    size_t *heap;       // Heap-ordered array of slots
+    size_t *position;   // Maps a slot to its index in the heap array
+    double *priority;   // Maps a slot to its current priority
+    uint32_t *generation;   // Bumped when a slot's element is removed
+    size_t size;        // Number of live elements
+    size_t allocated;   // Number of slots ever issued (live + recycled)
+    size_t capacity;    // Allocated length of all four arrays
+} IndexedHeap;
+
+/*
+ * Creates an empty indexed heap with default capacity
+ * Returns the heap pointer or NULL on failure
+ */
+IndexedHeap *ih_create() {
+    IndexedHeap *ih = malloc(sizeof(IndexedHeap));
+
+    if (!ih) {
+        return NULL;
+    }
+
+    ih->heap = malloc(DEFAULT_CAPACITY * sizeof(size_t));
+    ih->position = malloc(DEFAULT_CAPACITY * sizeof(size_t));
+    ih->priority = malloc(DEFAULT_CAPACITY * sizeof(double));
+    ih->generation = malloc(DEFAULT_CAPACITY * sizeof(uint32_t));
+
+    if (!ih->heap || !ih->position || !ih->priority || !ih->generation) {
+        free(ih->heap);
+        free(ih->position);
+        free(ih->priority);
+        free(ih->generation);
+        free(ih);
+        return NULL;
+    }
+
+    ih->size = 0;
+    ih->allocated = 0;
+    ih->capacity = DEFAULT_CAPACITY;
+
+    return ih;
+}
+
+/*
+ * Frees the heap, position map, priority and generation tables and the structure itself
+ */
+int ih_free(IndexedHeap *ih) {
+    if (!ih) {
+        return -1;
+    }
+
+    free(ih->heap);
+    free(ih->position);
+    free(ih->priority);
+    free(ih->generation);
+    free(ih);
+
+    return 0;
+}
+
+/*
+ * Doubles the capacity of all four arrays
+ * Each array is resized independently, so a failure part way through leaves
+ * the already-grown arrays larger than needed but still valid
+ */
+int ih_resize(IndexedHeap *ih) {
+    if (!ih) {
+        return -1;
+    }
+
+    size_t new_capacity = ih->capacity * 2;
+
+    size_t *heap = realloc(ih->heap, new_capacity * sizeof(size_t));
+    if (!heap) {
+        return -1;
+    }
+    ih->heap = heap;
+
+    size_t *position = realloc(ih->position, new_capacity * sizeof(size_t));
+    if (!position) {
+        return -1;
+    }
+    ih->position = position;
+
+    double *priority = realloc(ih->priority, new_capacity * sizeof(double));
+    if (!priority) {
+        return -1;
+    }
+    ih->priority = priority;
+
+    uint32_t *generation = realloc(ih->generation, new_capacity * sizeof(uint32_t));
+    if (!generation) {
+        return -1;
+    }
+    ih->generation = generation;
+
+    ih->capacity = new_capacity;
+
+    return 0;
+}
+
+/*
+ * Places a slot at index i and records the new position in the map
+ */
+static void ih_place(IndexedHeap *ih, size_t i, size_t slot) {
+    ih->heap[i] = slot;
+    ih->position[slot] = i;
+}
+
+static size_t ih_make_handle(IndexedHeap *ih, size_t slot) {
+    return ((size_t) ih->generation[slot] << IH_SLOT_BITS) | slot;
+}
+
+/*
+ * Returns the slot of the live element a handle refers to, or IH_INVALID_HANDLE if the
+ * handle was never issued or its element has been removed
+ */
+static size_t ih_resolve(IndexedHeap *ih, size_t handle) {
+    size_t slot = handle & IH_SLOT_MASK;
+
+    if (!ih || slot >= ih->allocated || ih->generation[slot] != handle >> IH_SLOT_BITS ||
+        ih->position[slot] >= ih->size) {
+        return IH_INVALID_HANDLE;
+    }
+
+    return slot;
+}
+
+/*
+ * Moves the handle at index i up until its parent has a higher or equal priority
+ */
+static void ih_sift_up(IndexedHeap *ih, size_t i) {
+    size_t handle = ih->heap[i];
+    double value = ih->priority[handle];
+
+    // Shift smaller parents down instead of swapping at every level
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (value > ih->priority[ih->heap[parent]]) {
+            ih_place(ih, i, ih->heap[parent]);
+            i = parent;
+        }
+        else {
+            break;
+        }
+    }
+
+    ih_place(ih, i, handle);
+}
+
+/*
+ * Moves the handle at index i down until both children have a lower or equal priority
+ */
+static void ih_sift_down(IndexedHeap *ih, size_t i) {
+    size_t handle = ih->heap[i];
+    double value = ih->priority[handle];
+
+    while (1) {
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        size_t largest = left;
+
+        if (left >= ih->size) {
+            break;
+        }
+
+        if (right < ih->size && ih->priority[ih->heap[right]] > ih->priority[ih->heap[left]]) {
+            largest = right;
+        }
+
+        if (ih->priority[ih->heap[largest]] > value) {
+            ih_place(ih, i, ih->heap[largest]);
+            i = largest;
+        }
+        else {
+            break;
+        }
+    }
+
+    ih_place(ih, i, handle);
+}
+
+/*
+ * Returns 1 if the handle refers to an element currently in the heap, 0 otherwise
+ * A handle is stale once its element is removed, even after its slot is reused
+ */
+int ih_contains(IndexedHeap *ih, size_t handle) {
+    return ih_resolve(ih, handle) != IH_INVALID_HANDLE;
+}
+
+/*
+ * Inserts a new priority and returns the handle that identifies it
+ * Slots of removed elements are recycled before new ones are issued, under a new
+ * generation, so the returned handle never equals one issued earlier for that slot
+ * Returns IH_INVALID_HANDLE on failure
+ */
+size_t ih_insert(IndexedHeap *ih, double priority) {
+    if (!ih) {
+        return IH_INVALID_HANDLE;
+    }
+
+    size_t slot;
+
+    if (ih->size < ih->allocated) {
+        // Reuse the slot parked just past the live region
+        slot = ih->heap[ih->size];
+    }
+    else {
+        // The all-ones slot is kept out of reach so IH_INVALID_HANDLE never resolves
+        if (ih->allocated >= IH_SLOT_MASK) {
+            return IH_INVALID_HANDLE;
+        }
+        if (ih->allocated >= ih->capacity) {
+            if (ih_resize(ih) != 0) {
+                return IH_INVALID_HANDLE;
+            }
+        }
+        slot = ih->allocated++;
+        ih->generation[slot] = 0;
+    }
+
+    ih->priority[slot] = priority;
+    ih_place(ih, ih->size, slot);
+    ih->size++;
+
+    ih_sift_up(ih, ih->size - 1);
+
+    return ih_make_handle(ih, slot);
+}
+
+/*
+ * Changes the priority of a live element and restores the heap property
+ * Works for both increase-key and decrease-key in O(log n)
+ */
+int ih_update_key(IndexedHeap *ih, size_t handle, double priority) {
+    size_t slot = ih_resolve(ih, handle);
+
+    if (slot == IH_INVALID_HANDLE) {
+        return -1;
+    }
+
+    double old_priority = ih->priority[slot];
+    ih->priority[slot] = priority;
+
+    // A higher priority can only move up, a lower one can only move down
+    if (priority > old_priority) {
+        ih_sift_up(ih, ih->position[slot]);
+    }
+    else {
+        ih_sift_down(ih, ih->position[slot]);
+    }
+
+    return 0;
+}
+
+/*
+ * Removes the live element in a slot
+ * The last element fills the gap, and the slot is parked past the live region under a
+ * new generation, so every handle to the removed element goes stale
+ */
+static void ih_remove_slot(IndexedHeap *ih, size_t slot) {
+    size_t i = ih->position[slot];
+    size_t last = ih->heap[ih->size - 1];
+
+    ih->size--;
+    ih->generation[slot] = (uint32_t) ((ih->generation[slot] + 1) & IH_GENERATION_MASK);
+
+    // Swap the removed slot into the freed position so it can be recycled later
+    ih_place(ih, ih->size, slot);
+
+    if (i < ih->size) {
+        ih_place(ih, i, last);
+
+        // The replacement may belong above or below its new position
+        if (i > 0 && ih->priority[last] > ih->priority[ih->heap[(i - 1) / 2]]) {
+            ih_sift_up(ih, i);
+        }
+        else {
+            ih_sift_down(ih, i);
+        }
+    }
+}
+
+/*
+ * Removes a live element by handle in O(log n); the handle is invalid afterwards
+ */
+int ih_remove(IndexedHeap *ih, size_t handle) {
+    size_t slot = ih_resolve(ih, handle);
+
+    if (slot == IH_INVALID_HANDLE) {
+        return -1;
+    }
+
+    ih_remove_slot(ih, slot);
+
+    return 0;
+}
+
+/*
+ * Returns the priority stored for a live handle, or NAN if the handle is not in the heap
+ */
+double ih_get(IndexedHeap *ih, size_t handle) {
+    size_t slot = ih_resolve(ih, handle);
+
+    return slot != IH_INVALID_HANDLE ? ih->priority[slot] : NAN;
+}
+
+/*
+ * Returns the maximum priority without removing it
+ */
+double ih_peek(IndexedHeap *ih) {
+    return (ih && ih->size > 0) ? ih->priority[ih->heap[0]] : NAN;
+}
+
+/*
+ * Returns the handle of the maximum element without removing it
+ */
+size_t ih_peek_handle(IndexedHeap *ih) {
+    return (ih && ih->size > 0) ? ih_make_handle(ih, ih->heap[0]) : IH_INVALID_HANDLE;
+}
+
+/*
+ * Removes and returns the maximum priority
+ * The handle of the removed element is written to *handle if it is not NULL, so the
+ * caller can tell which element it was; that handle is already stale
+ */
+double ih_pop_max(IndexedHeap *ih, size_t *handle) {
+    if (!ih || ih->size == 0) {
+        return NAN;
+    }
+
+    size_t top = ih->heap[0];
+    double root = ih->priority[top];
+
+    if (handle) {
+        *handle = ih_make_handle(ih, top);
+    }
+
+    ih_remove_slot(ih, top);
+
+    return root;
+}
+
+/*
+ * Returns the number of live elements in the heap
+ */
+size_t ih_size(IndexedHeap *ih) {
+    return ih ? ih->size : 0;
+}
@@ -1,5 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "functions.h"
+#include "serialize_internal.h"
+#include "stats_internal.h"
+
+#define LL_SERIAL_BATCH 512     // Node values gathered per write or read
 
 // Represents a single link in the list
 typedef struct Node {
@@ -12,21 +19,37 @@ typedef struct LinkedList {
     Node *head;     // Pointer to the first node
     Node *tail;     // Pointer to the last node
     size_t size;    // Total number of nodes
+    Allocator allocator;    // Source of the list and every node
+    STATS_FIELD             // Operation counters, only present when built with LDS_STATS
 } LinkedList;
 
 /*
  * Allocates and initializes an empty linked list
  */
 LinkedList *ll_create() {
-    LinkedList *ll = malloc(sizeof(LinkedList));
+    return ll_create_with_allocator(NULL);
+}
+
+/*
+ * Same as ll_create, but the list and its nodes come from the given allocator
+ * Passing NULL selects the default malloc-based allocator
+ */
+LinkedList *ll_create_with_allocator(const Allocator *allocator) {
+    if (!allocator) {
+        allocator = allocator_default();
+    }
+
+    LinkedList *ll = allocator_alloc(allocator, sizeof(LinkedList));
 
     if (!ll) {
         return NULL;
     }
 
+    ll->allocator = *allocator;
     ll->head = NULL;
     ll->tail = NULL;
     ll->size = 0;
+    STATS_INIT(ll);
 
     return ll;
 }
@@ -39,16 +62,19 @@ int ll_free(LinkedList *ll) {
         return -1;
     }
 
+    STATS_FREE(ll, "linked_list");
+
+    Allocator allocator = ll->allocator;
     Node *current_node = ll->head;
     Node *next_node;
 
     while (current_node != NULL) {
         next_node = current_node->next; // Save the next pointer before freeing
-        free(current_node);
+        allocator_free(&allocator, current_node, sizeof(Node));
         current_node = next_node;
     }
 
-    free(ll);
+    allocator_free(&allocator, ll, sizeof(LinkedList));
 
     return 0;
 }
@@ -69,6 +95,8 @@ Node* ll_at(LinkedList *ll, size_t index) {
         current = current->next;
     }
 
+    STATS_PROBE(ll, index);
+
     return current;
 }
 
@@ -76,7 +104,9 @@ Node* ll_at(LinkedList *ll, size_t index) {
  * Inserts a new node at the very beginning of the list
  */
 int ll_insert_head(LinkedList *ll, double value) {
-    Node *new_node = malloc(sizeof(Node));
+    STATS_TIMER_START();
+
+    Node *new_node = allocator_alloc(&ll->allocator, sizeof(Node));
 
     if (!new_node) {
         return -1;
@@ -92,6 +122,9 @@ int ll_insert_head(LinkedList *ll, double value) {
     }
 
     ll->size++;
+    STATS_COUNT(ll, inserts);
+    STATS_SIZE(ll, ll->size);
+    STATS_TIMER_STOP(ll);
     return 0;
 }
 
@@ -100,7 +133,9 @@ int ll_insert_head(LinkedList *ll, double value) {
  * This is O(1) thanks to the 'tail' pointer
  */
 int ll_insert_tail(LinkedList *ll, double value) {
-    Node *new_node = malloc(sizeof(Node));
+    STATS_TIMER_START();
+
+    Node *new_node = allocator_alloc(&ll->allocator, sizeof(Node));
 
     if (!new_node) {
         return -1;
@@ -121,6 +156,9 @@ int ll_insert_tail(LinkedList *ll, double value) {
     }
 
     ll->size++;
+    STATS_COUNT(ll, inserts);
+    STATS_SIZE(ll, ll->size);
+    STATS_TIMER_STOP(ll);
     return 0;
 }
 
@@ -136,7 +174,9 @@ int ll_insert_at(LinkedList *ll, double value, size_t index) {
         return ll_insert_head(ll, value);
     }
 
-    Node *new_node = malloc(sizeof(Node));
+    STATS_TIMER_START();
+
+    Node *new_node = allocator_alloc(&ll->allocator, sizeof(Node));
 
     if (!new_node) {
         return -1;
@@ -149,6 +189,10 @@ int ll_insert_at(LinkedList *ll, double value, size_t index) {
     previous->next = new_node;
     ll->size++;
 
+    STATS_COUNT(ll, inserts);
+    STATS_SIZE(ll, ll->size);
+    STATS_TIMER_STOP(ll);
+
     return 0;
 }
 
@@ -160,9 +204,11 @@ int ll_remove_head(LinkedList *ll) {
         return -1;
     }
 
+    STATS_TIMER_START();
+
     Node *buffer = ll->head;
     ll->head = buffer->next;    // Move head pointer to the second node
-    free(buffer);
+    allocator_free(&ll->allocator, buffer, sizeof(Node));
     ll->size--;
 
     // If the list is now empty, reset tail to NULL
@@ -170,6 +216,10 @@ int ll_remove_head(LinkedList *ll) {
         ll->tail = NULL;
     }
 
+    STATS_COUNT(ll, removals);
+    STATS_SIZE(ll, ll->size);
+    STATS_TIMER_STOP(ll);
+
     return 0;
 }
 
@@ -186,6 +236,8 @@ int ll_remove_tail(LinkedList *ll) {
         return ll_remove_head(ll);
     }
 
+    STATS_TIMER_START();
+
     // Find the (n - 1)th node
     Node *second_to_last = ll_at(ll, ll->size - 2);
     Node *node_to_delete = second_to_last->next;
@@ -193,8 +245,11 @@ int ll_remove_tail(LinkedList *ll) {
     second_to_last->next = NULL;
     ll->tail = second_to_last;  // Update tail pointer
 
-    free(node_to_delete);
+    allocator_free(&ll->allocator, node_to_delete, sizeof(Node));
     ll->size--;
+    STATS_COUNT(ll, removals);
+    STATS_SIZE(ll, ll->size);
+    STATS_TIMER_STOP(ll);
     return 0;
 }
 
@@ -214,6 +269,8 @@ int ll_remove_at(LinkedList *ll,size_t index) {
         return ll_remove_head(ll);
     }
 
+    STATS_TIMER_START();
+
     // Get the node before the one we want to delete
     Node *current = ll_at(ll, index - 1);
 
@@ -223,9 +280,13 @@ int ll_remove_at(LinkedList *ll,size_t index) {
 
     Node *node_to_delete = current->next;
     current->next = node_to_delete->next;   // Bypass the node
-    free(node_to_delete);
+    allocator_free(&ll->allocator, node_to_delete, sizeof(Node));
     ll->size--;
 
+    STATS_COUNT(ll, removals);
+    STATS_SIZE(ll, ll->size);
+    STATS_TIMER_STOP(ll);
+
     return 0;
 }
 
@@ -247,3 +308,85 @@ void ll_print(LinkedList *ll) {
 
     printf("NULL\n");
 }
+
+/*
+ * Copies the list's counters into *out
+ * Returns -1 if the library was built without LDS_STATS
+ */
+int ll_stats(LinkedList *ll, DsStats *out) {
+    if (!ll || !out) {
+        return -1;
+    }
+
+    return STATS_COPY(ll, out);
+}
+
+/*
+ * Writes the list to fd as a binary image, head to tail
+ * Node values are gathered into a small buffer so each write moves many of them
+ */
+int ll_write(LinkedList *ll, int fd) {
+    if (!ll) {
+        return -1;
+    }
+
+    if (serial_write_header(fd, SERIAL_LINKED_LIST, ll->size) != 0) {
+        return -1;
+    }
+
+    double batch[LL_SERIAL_BATCH];
+    size_t filled = 0;
+
+    for (Node *current = ll->head; current != NULL; current = current->next) {
+        batch[filled++] = current->data;
+
+        if (filled == LL_SERIAL_BATCH) {
+            if (serial_write_doubles(fd, batch, filled) != 0) {
+                return -1;
+            }
+            filled = 0;
+        }
+    }
+
+    return serial_write_doubles(fd, batch, filled);
+}
+
+/*
+ * Loads an image written by ll_write, reading the values in batches
+ * Returns NULL if the image is malformed or truncated
+ */
+LinkedList *ll_read(int fd) {
+    size_t count;
+
+    if (serial_read_header(fd, SERIAL_LINKED_LIST, &count) != 0) {
+        return NULL;
+    }
+
+    LinkedList *ll = ll_create();
+
+    if (!ll) {
+        return NULL;
+    }
+
+    double batch[LL_SERIAL_BATCH];
+
+    while (count > 0) {
+        size_t n = count < LL_SERIAL_BATCH ? count : LL_SERIAL_BATCH;
+
+        if (serial_read_doubles(fd, batch, n) != 0) {
+            ll_free(ll);
+            return NULL;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            if (ll_insert_tail(ll, batch[i]) != 0) {
+                ll_free(ll);
+                return NULL;
+            }
+        }
+
+        count -= n;
+    }
+
+    return ll;
+}
@@ -0,0 +1,287 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "functions.h"
+
+#define DEFAULT_CAPACITY 100    // The starting size for the dynamic min-max heap array
+
+/*
+ * Structure for a min-max heap using a contiguous array
+ * Even levels (starting with the root) are ordered as a min-heap and odd
+ * levels as a max-heap, so both ends are reachable in O(1)
+ */
+typedef struct MinMaxHeap {
+    double *data;       // Array storing the heap elements
+    size_t size;        // Current number of elements
+    size_t capacity;    // Total allocated space
+} MinMaxHeap;
+
+/*
+ * Creates an empty min-max heap with default capacity
+ */
+MinMaxHeap *mmh_create() {
+    MinMaxHeap *mmh = malloc(sizeof(MinMaxHeap));
+
+    if (!mmh) {
+        return NULL;
+    }
+
+    mmh->data = malloc(DEFAULT_CAPACITY * sizeof(double));
+
+    if (!mmh->data) {
+        free(mmh);
+        return NULL;
+    }
+
+    mmh->size = 0;
+    mmh->capacity = DEFAULT_CAPACITY;
+
+    return mmh;
+}
+
+/*
+ * Frees the memory allocated for the heap array and structure
+ */
+int mmh_free(MinMaxHeap *mmh) {
+    if (!mmh) {
+        return -1;
+    }
+
+    free(mmh->data);
+    free(mmh);
+    return 0;
+}
+
+/*
+ * Doubles the internal array when capacity is reached
+ */
+int mmh_resize(MinMaxHeap *mmh) {
+    if (!mmh) {
+        return -1;
+    }
+
+    size_t new_capacity = mmh->capacity * 2;
+
+    double *buffer = realloc(mmh->data, new_capacity * sizeof(double));
+
+    if (!buffer) {
+        return -1;
+    }
+
+    mmh->data = buffer;
+    mmh->capacity = new_capacity;
+
+    return 0;
+}
+
+/*
+ * Returns 1 if index i sits on a min (even) level of the tree
+ */
+static int mmh_on_min_level(size_t i) {
+    int level = 0;
+
+    // The level of index i is floor(log2(i + 1))
+    for (i = i + 1; i > 1; i >>= 1) {
+        level++;
+    }
+
+    return level % 2 == 0;
+}
+
+static inline void mmh_swap(double *data, size_t a, size_t b) {
+    double buffer = data[a];
+    data[a] = data[b];
+    data[b] = buffer;
+}
+
+/*
+ * Generates the push-up and push-down routines for one kind of level
+ * HIGHER(a, b) is true when a belongs closer to the root of that level kind
+ * Min levels use "<" and max levels use ">", both inlined at compile time
+ */
+#define MMH_DEFINE_LEVEL(name, HIGHER)                                          \
+    static void mmh_push_up_##name(double *data, size_t i) {                    \
+        /* Compare against grandparents, which sit on the same kind of level */ \
+        while (i > 2) {                                                         \
+            size_t grandparent = ((i - 1) / 2 - 1) / 2;                         \
+            if (!HIGHER(data[i], data[grandparent])) {                          \
+                break;                                                          \
+            }                                                                   \
+            mmh_swap(data, i, grandparent);                                     \
+            i = grandparent;                                                    \
+        }                                                                       \
+    }                                                                           \
+                                                                                \
+    static void mmh_push_down_##name(double *data, size_t size, size_t i) {     \
+        while (2 * i + 1 < size) {                                              \
+            /* Find the highest among children and grandchildren */            \
+            size_t best = 2 * i + 1;                                            \
+            size_t first_grandchild = 4 * i + 3;                                \
+            if (best + 1 < size && HIGHER(data[best + 1], data[best])) {        \
+                best = best + 1;                                                \
+            }                                                                   \
+            for (size_t g = first_grandchild;                                   \
+                 g < first_grandchild + 4 && g < size; g++) {                   \
+                if (HIGHER(data[g], data[best])) {                              \
+                    best = g;                                                   \
+                }                                                               \
+            }                                                                   \
+                                                                                \
+            if (!HIGHER(data[best], data[i])) {                                 \
+                break;                                                          \
+            }                                                                   \
+            mmh_swap(data, i, best);                                            \
+                                                                                \
+            /* A child is on the opposite level kind, so no further descent */ \
+            if (best < first_grandchild) {                                      \
+                break;                                                          \
+            }                                                                   \
+                                                                                \
+            /* The value moved down may now violate its parent's ordering */   \
+            size_t parent = (best - 1) / 2;                                     \
+            if (HIGHER(data[parent], data[best])) {                             \
+                mmh_swap(data, parent, best);                                   \
+            }                                                                   \
+            i = best;                                                           \
+        }                                                                       \
+    }
+
+#define MMH_MIN_HIGHER(a, b) ((a) < (b))
+#define MMH_MAX_HIGHER(a, b) ((a) > (b))
+
+MMH_DEFINE_LEVEL(min, MMH_MIN_HIGHER)
+MMH_DEFINE_LEVEL(max, MMH_MAX_HIGHER)
+
+/*
+ * Restores order after the value at index i was replaced
+ */
+static void mmh_push_down(MinMaxHeap *mmh, size_t i) {
+    if (mmh_on_min_level(i)) {
+        mmh_push_down_min(mmh->data, mmh->size, i);
+    }
+    else {
+        mmh_push_down_max(mmh->data, mmh->size, i);
+    }
+}
+
+/*
+ * Inserts a new value into the heap
+ * The value first settles against its parent, then climbs its own kind of level
+ */
+void mmh_insert(MinMaxHeap *mmh, double value) {
+    if (!mmh) {
+        return;
+    }
+
+    if (mmh->size >= mmh->capacity) {
+        if (mmh_resize(mmh) != 0) {
+            return;
+        }
+    }
+
+    size_t i = mmh->size;
+    mmh->data[i] = value;
+    mmh->size++;
+
+    if (i == 0) {
+        return;
+    }
+
+    size_t parent = (i - 1) / 2;
+
+    if (mmh_on_min_level(i)) {
+        // A value larger than its max-level parent belongs with the maxima
+        if (mmh->data[i] > mmh->data[parent]) {
+            mmh_swap(mmh->data, i, parent);
+            mmh_push_up_max(mmh->data, parent);
+        }
+        else {
+            mmh_push_up_min(mmh->data, i);
+        }
+    }
+    else {
+        // A value smaller than its min-level parent belongs with the minima
+        if (mmh->data[i] < mmh->data[parent]) {
+            mmh_swap(mmh->data, i, parent);
+            mmh_push_up_min(mmh->data, parent);
+        }
+        else {
+            mmh_push_up_max(mmh->data, i);
+        }
+    }
+}
+
+/*
+ * Returns the index of the maximum element, which is one of the root's children
+ */
+static size_t mmh_max_index(MinMaxHeap *mmh) {
+    if (mmh->size == 1) {
+        return 0;
+    }
+
+    if (mmh->size == 2 || mmh->data[1] >= mmh->data[2]) {
+        return 1;
+    }
+
+    return 2;
+}
+
+/*
+ * Removes the element at index i by moving the last element into its place
+ */
+static double mmh_remove_at(MinMaxHeap *mmh, size_t i) {
+    double removed = mmh->data[i];
+
+    mmh->data[i] = mmh->data[mmh->size - 1];
+    mmh->size--;
+
+    if (i < mmh->size) {
+        mmh_push_down(mmh, i);
+    }
+
+    return removed;
+}
+
+/*
+ * Returns the minimum value without removing it
+ */
+double mmh_peek_min(MinMaxHeap *mmh) {
+    return (mmh && mmh->size > 0) ? mmh->data[0] : NAN;
+}
+
+/*
+ * Returns the maximum value without removing it
+ */
+double mmh_peek_max(MinMaxHeap *mmh) {
+    return (mmh && mmh->size > 0) ? mmh->data[mmh_max_index(mmh)] : NAN;
+}
+
+/*
+ * Removes and returns the minimum value
+ */
+double mmh_pop_min(MinMaxHeap *mmh) {
+    if (!mmh || mmh->size == 0) {
+        return NAN;
+    }
+
+    return mmh_remove_at(mmh, 0);
+}
+
+/*
+ * Removes and returns the maximum value
+ */
+double mmh_pop_max(MinMaxHeap *mmh) {
+    if (!mmh || mmh->size == 0) {
+        return NAN;
+    }
+
+    return mmh_remove_at(mmh, mmh_max_index(mmh));
+}
+
+/*
+ * Returns the number of elements in the heap
+ */
+size_t mmh_size(MinMaxHeap *mmh) {
+    return mmh ? mmh->size : 0;
+}
@@ -0,0 +1,255 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "functions.h"
+
+#define DEFAULT_HEAPS 8     // Number of sub-heaps used when the caller passes 0
+#define CACHE_LINE 64       // Shards are padded to this size to avoid false sharing
+
+/*
+ * One sub-heap of the multi-queue
+ * The cached top lets pops compare two shards without taking either lock
+ */
+typedef struct Shard {
+    _Alignas(CACHE_LINE) pthread_mutex_t lock;
+    Heap *heap;
+    _Atomic(double) top;    // Maximum of the heap, or -INFINITY when empty
+} Shard;
+
+/*
+ * Structure for a relaxed concurrent max-priority queue
+ * Built from several independent Heap instances, each guarded by its own lock
+ */
+typedef struct MultiQueue {
+    Shard *shards;
+    size_t count;   // Number of sub-heaps
+} MultiQueue;
+
+// Per-thread xorshift state so choosing a shard never touches shared memory
+static _Thread_local uint64_t mq_rng_state;
+
+/*
+ * Returns a pseudo-random number from the calling thread's generator
+ */
+static uint64_t mq_random() {
+    if (mq_rng_state == 0) {
+        // Seed from the address of the thread-local state, which differs per thread
+        static atomic_uint_fast64_t seed_counter = 1;
+        mq_rng_state = ((uint64_t) (uintptr_t) &mq_rng_state) ^
+                       (atomic_fetch_add(&seed_counter, 1) * 0x9E3779B97F4A7C15ULL);
+        if (mq_rng_state == 0) {
+            mq_rng_state = 0x9E3779B97F4A7C15ULL;
+        }
+    }
+
+    mq_rng_state ^= mq_rng_state << 13;
+    mq_rng_state ^= mq_rng_state >> 7;
+    mq_rng_state ^= mq_rng_state << 17;
+
+    return mq_rng_state;
+}
+
+/*
+ * Refreshes the cached top of a shard; must be called with the shard locked
+ */
+static void mq_publish_top(Shard *shard) {
+    double top = h_size(shard->heap) > 0 ? h_peek(shard->heap) : -INFINITY;
+    atomic_store_explicit(&shard->top, top, memory_order_relaxed);
+}
+
+/*
+ * Creates a multi-queue made of num_heaps sub-heaps (DEFAULT_HEAPS if 0)
+ * Two to four sub-heaps per worker thread is a good starting point
+ */
+MultiQueue *mq_create(size_t num_heaps) {
+    if (num_heaps == 0) {
+        num_heaps = DEFAULT_HEAPS;
+    }
+
+    // Two-choice pops need at least two distinct shards
+    if (num_heaps < 2) {
+        num_heaps = 2;
+    }
+
+    MultiQueue *mq = malloc(sizeof(MultiQueue));
+
+    if (!mq) {
+        return NULL;
+    }
+
+    mq->shards = aligned_alloc(CACHE_LINE, num_heaps * sizeof(Shard));
+
+    if (!mq->shards) {
+        free(mq);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < num_heaps; i++) {
+        Shard *shard = &mq->shards[i];
+        shard->heap = h_create();
+
+        if (!shard->heap) {
+            // Unwind the shards that were already set up
+            while (i-- > 0) {
+                pthread_mutex_destroy(&mq->shards[i].lock);
+                h_free(mq->shards[i].heap);
+            }
+            free(mq->shards);
+            free(mq);
+            return NULL;
+        }
+
+        pthread_mutex_init(&shard->lock, NULL);
+        atomic_init(&shard->top, -INFINITY);
+    }
+
+    mq->count = num_heaps;
+
+    return mq;
+}
+
+/*
+ * Frees every sub-heap and the multi-queue itself
+ * No other thread may be using the queue at this point
+ */
+int mq_free(MultiQueue *mq) {
+    if (!mq) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < mq->count; i++) {
+        pthread_mutex_destroy(&mq->shards[i].lock);
+        h_free(mq->shards[i].heap);
+    }
+
+    free(mq->shards);
+    free(mq);
+
+    return 0;
+}
+
+/*
+ * Inserts a value into a randomly chosen sub-heap
+ * A busy shard is never waited on; another random shard is tried instead
+ */
+int mq_insert(MultiQueue *mq, double value) {
+    if (!mq) {
+        return -1;
+    }
+
+    while (1) {
+        Shard *shard = &mq->shards[mq_random() % mq->count];
+
+        if (pthread_mutex_trylock(&shard->lock) != 0) {
+            continue;
+        }
+
+        size_t before = h_size(shard->heap);
+        h_insert(shard->heap, value);
+        int inserted = h_size(shard->heap) > before;
+
+        mq_publish_top(shard);
+        pthread_mutex_unlock(&shard->lock);
+
+        return inserted ? 0 : -1;
+    }
+}
+
+/*
+ * Pops the top of a shard without waiting for its lock
+ * Returns NAN if the shard is busy or turned out to be empty
+ */
+static double mq_try_pop(Shard *shard) {
+    if (pthread_mutex_trylock(&shard->lock) != 0) {
+        return NAN;
+    }
+
+    double value = NAN;
+
+    if (h_size(shard->heap) > 0) {
+        value = h_pop_max(shard->heap);
+    }
+
+    mq_publish_top(shard);
+    pthread_mutex_unlock(&shard->lock);
+
+    return value;
+}
+
+/*
+ * Removes and returns a value close to the maximum
+ * Two random shards are sampled and the one with the larger top is popped, so
+ * the result is not always the global maximum: the expected rank of the
+ * returned element is O(num_heaps) and does not grow with the number of elements
+ * Returns NAN only after every shard has been checked under its lock and found empty
+ */
+double mq_pop_max(MultiQueue *mq) {
+    if (!mq) {
+        return NAN;
+    }
+
+    // Fast path: a bounded number of lock-free two-choice attempts
+    for (size_t attempt = 0; attempt < 2 * mq->count; attempt++) {
+        size_t a = mq_random() % mq->count;
+        size_t b = mq_random() % (mq->count - 1);
+        if (b >= a) {
+            b++;    // Guarantees two distinct shards
+        }
+
+        double top_a = atomic_load_explicit(&mq->shards[a].top, memory_order_relaxed);
+        double top_b = atomic_load_explicit(&mq->shards[b].top, memory_order_relaxed);
+
+        if (top_a == -INFINITY && top_b == -INFINITY) {
+            continue;
+        }
+
+        double value = mq_try_pop(&mq->shards[top_a >= top_b ? a : b]);
+
+        if (!isnan(value)) {
+            return value;
+        }
+    }
+
+    // Slow path: the queue looks empty, so confirm by visiting every shard
+    for (size_t i = 0; i < mq->count; i++) {
+        Shard *shard = &mq->shards[i];
+        double value = NAN;
+
+        pthread_mutex_lock(&shard->lock);
+        if (h_size(shard->heap) > 0) {
+            value = h_pop_max(shard->heap);
+        }
+        mq_publish_top(shard);
+        pthread_mutex_unlock(&shard->lock);
+
+        if (!isnan(value)) {
+            return value;
+        }
+    }
+
+    return NAN;
+}
+
+/*
+ * Returns the number of elements across all sub-heaps
+ * Shards are read one at a time, so the result is only a snapshot under concurrency
+ */
+size_t mq_size(MultiQueue *mq) {
+    if (!mq) {
+        return 0;
+    }
+
+    size_t total = 0;
+
+    for (size_t i = 0; i < mq->count; i++) {
+        pthread_mutex_lock(&mq->shards[i].lock);
+        total += h_size(mq->shards[i].heap);
+        pthread_mutex_unlock(&mq->shards[i].lock);
+    }
+
+    return total;
+}
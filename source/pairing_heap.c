@@ -0,0 +1,298 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "functions.h"
+
+#define SLAB_NODES 256  // Number of nodes carved out of each pool allocation
+
+// A heap-ordered tree node stored as left-child, right-sibling
+typedef struct PairingNode {
+    double value;
+    struct PairingNode *child;      // First (leftmost) child
+    struct PairingNode *sibling;    // Next sibling, or next free node while pooled
+} PairingNode;
+
+// One block of nodes handed out by the pool
+typedef struct NodeSlab {
+    struct NodeSlab *next;
+    PairingNode nodes[SLAB_NODES];
+} NodeSlab;
+
+/*
+ * Structure for a max-ordered pairing heap
+ * Nodes come from slabs owned by the heap, so inserting never calls malloc
+ * per element and melding two heaps only splices their pools together
+ */
+typedef struct PairingHeap {
+    PairingNode *root;      // Node holding the maximum value
+    size_t size;            // Current number of elements
+    NodeSlab *slabs;        // Every slab owned by this heap
+    NodeSlab *slabs_tail;   // Last slab, kept for O(1) splicing
+    PairingNode *free_head; // Pool of unused nodes
+    PairingNode *free_tail; // Last unused node, kept for O(1) splicing
+} PairingHeap;
+
+/*
+ * Creates an empty pairing heap
+ * The node pool is filled lazily on the first insert
+ */
+PairingHeap *ph_create() {
+    PairingHeap *ph = malloc(sizeof(PairingHeap));
+
+    if (!ph) {
+        return NULL;
+    }
+
+    ph->root = NULL;
+    ph->size = 0;
+    ph->slabs = NULL;
+    ph->slabs_tail = NULL;
+    ph->free_head = NULL;
+    ph->free_tail = NULL;
+
+    return ph;
+}
+
+/*
+ * Frees every slab and the heap structure
+ * Nodes are never freed individually, so no tree walk is needed
+ */
+int ph_free(PairingHeap *ph) {
+    if (!ph) {
+        return -1;
+    }
+
+    NodeSlab *current_slab = ph->slabs;
+
+    while (current_slab != NULL) {
+        NodeSlab *next_slab = current_slab->next;
+        free(current_slab);
+        current_slab = next_slab;
+    }
+
+    free(ph);
+
+    return 0;
+}
+
+/*
+ * Adds a fresh slab to the pool and threads its nodes onto the free list
+ */
+static int ph_pool_grow(PairingHeap *ph) {
+    NodeSlab *slab = malloc(sizeof(NodeSlab));
+
+    if (!slab) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < SLAB_NODES - 1; i++) {
+        slab->nodes[i].sibling = &slab->nodes[i + 1];
+    }
+    slab->nodes[SLAB_NODES - 1].sibling = NULL;
+
+    slab->next = NULL;
+    if (ph->slabs_tail) {
+        ph->slabs_tail->next = slab;
+    }
+    else {
+        ph->slabs = slab;
+    }
+    ph->slabs_tail = slab;
+
+    ph->free_head = &slab->nodes[0];
+    ph->free_tail = &slab->nodes[SLAB_NODES - 1];
+
+    return 0;
+}
+
+/*
+ * Takes a node from the pool, growing it if empty
+ */
+static PairingNode *ph_node_alloc(PairingHeap *ph) {
+    if (!ph->free_head && ph_pool_grow(ph) != 0) {
+        return NULL;
+    }
+
+    PairingNode *node = ph->free_head;
+    ph->free_head = node->sibling;
+
+    if (!ph->free_head) {
+        ph->free_tail = NULL;
+    }
+
+    return node;
+}
+
+/*
+ * Returns a node to the front of the pool
+ */
+static void ph_node_release(PairingHeap *ph, PairingNode *node) {
+    node->sibling = ph->free_head;
+    ph->free_head = node;
+
+    if (!ph->free_tail) {
+        ph->free_tail = node;
+    }
+}
+
+/*
+ * Links two roots, making the smaller one the leftmost child of the larger
+ */
+static PairingNode *ph_link(PairingNode *a, PairingNode *b) {
+    if (!a) {
+        return b;
+    }
+
+    if (!b) {
+        return a;
+    }
+
+    if (b->value > a->value) {
+        PairingNode *buffer = a;
+        a = b;
+        b = buffer;
+    }
+
+    b->sibling = a->child;
+    a->child = b;
+
+    return a;
+}
+
+/*
+ * Inserts a new value in O(1) by linking a single-node tree with the root
+ */
+void ph_insert(PairingHeap *ph, double value) {
+    if (!ph) {
+        return;
+    }
+
+    PairingNode *node = ph_node_alloc(ph);
+
+    if (!node) {
+        return;
+    }
+
+    node->value = value;
+    node->child = NULL;
+    node->sibling = NULL;
+
+    ph->root = ph_link(ph->root, node);
+    ph->size++;
+}
+
+/*
+ * Returns the maximum value (root) without removing it
+ */
+double ph_peek(PairingHeap *ph) {
+    return (ph && ph->root) ? ph->root->value : NAN;
+}
+
+/*
+ * Removes and returns the maximum value
+ * The root's children are combined with the standard two-pass pairing:
+ * link neighbours left to right, then fold the pairs right to left
+ */
+double ph_pop_max(PairingHeap *ph) {
+    if (!ph || !ph->root) {
+        return NAN;
+    }
+
+    PairingNode *old_root = ph->root;
+    double root = old_root->value;
+
+    // First pass: link children in pairs, stacking each pair in reverse order
+    PairingNode *pairs = NULL;
+    PairingNode *current = old_root->child;
+
+    while (current != NULL) {
+        PairingNode *first = current;
+        PairingNode *second = first->sibling;
+
+        if (!second) {
+            first->sibling = pairs;
+            pairs = first;
+            break;
+        }
+
+        current = second->sibling;
+        first->sibling = NULL;
+        second->sibling = NULL;
+
+        PairingNode *linked = ph_link(first, second);
+        linked->sibling = pairs;
+        pairs = linked;
+    }
+
+    // Second pass: the stack already runs right to left, so fold it in order
+    PairingNode *new_root = NULL;
+
+    while (pairs != NULL) {
+        PairingNode *next = pairs->sibling;
+        pairs->sibling = NULL;
+        new_root = ph_link(new_root, pairs);
+        pairs = next;
+    }
+
+    ph->root = new_root;
+    ph->size--;
+    ph_node_release(ph, old_root);
+
+    return root;
+}
+
+/*
+ * Moves every element of src into dst in O(1)
+ * The roots are linked and src's node pool is spliced onto dst's, leaving src
+ * empty but still valid; the caller must still free it with ph_free
+ */
+int ph_meld(PairingHeap *dst, PairingHeap *src) {
+    if (!dst || !src) {
+        return -1;
+    }
+
+    if (dst == src) {
+        return 0;
+    }
+
+    dst->root = ph_link(dst->root, src->root);
+    dst->size += src->size;
+
+    // The melded nodes still live in src's slabs, so the slabs must follow them
+    if (src->slabs) {
+        if (dst->slabs_tail) {
+            dst->slabs_tail->next = src->slabs;
+        }
+        else {
+            dst->slabs = src->slabs;
+        }
+        dst->slabs_tail = src->slabs_tail;
+    }
+
+    if (src->free_head) {
+        if (dst->free_tail) {
+            dst->free_tail->sibling = src->free_head;
+        }
+        else {
+            dst->free_head = src->free_head;
+        }
+        dst->free_tail = src->free_tail;
+    }
+
+    src->root = NULL;
+    src->size = 0;
+    src->slabs = NULL;
+    src->slabs_tail = NULL;
+    src->free_head = NULL;
+    src->free_tail = NULL;
+
+    return 0;
+}
+
+/*
+ * Returns the number of elements in the heap
+ */
+size_t ph_size(PairingHeap *ph) {
+    return ph ? ph->size : 0;
+}
@@ -0,0 +1,27 @@
+#ifndef PARALLEL_INTERNAL_H
+#define PARALLEL_INTERNAL_H
+
+#include <stddef.h>
+
+#include "functions.h"
+
+/*
+ * Bulk operations split their work into numbered tasks and hand them to a ThreadPool
+ * Each caller arranges for its result not to depend on how the work is split or
+ * which thread runs which task, so it is the same for any pool size, or no pool
+ */
+
+/*
+ * Runs body(context, task) for every task in [0, tasks) and waits for all of them
+ * The calling thread claims tasks alongside at most tp_size(pool) - 1 helper tasks and
+ * waits only for this call's tasks, so the pool may be busy with other work, or be the
+ * one the caller is running on; without a pool every task runs on the calling thread
+ */
+void parallel_for(ThreadPool *pool, size_t tasks, void (*body)(void *context, size_t task), void *context);
+
+/*
+ * Returns the number of pieces worth splitting work into: one per worker, or 1 without a pool
+ */
+size_t parallel_width(ThreadPool *pool);
+
+#endif
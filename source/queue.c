@@ -1,8 +1,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
 
-#define DEFAULT_SIZE 100    // The starting size for the dynamic queue array
+#include "functions.h"
+#include "growth_internal.h"
+#include "serialize_internal.h"
+#include "simd_kernels.h"
+#include "stats_internal.h"
 
 // Structure to represent a circular dynamic queue
 typedef struct Queue {
@@ -11,6 +16,9 @@ typedef struct Queue {
     size_t tail; // Index of the last element
     size_t capacity; // Max number of elements currently possible
     size_t size; // Current number of elements in the queue
+    GrowthPolicy policy; // Initial capacity, growth factor and shrink threshold
+    Allocator allocator; // Source of every allocation made for this queue
+    STATS_FIELD // Operation counters, only present when built with LDS_STATS
 } Queue;
 
 /*
@@ -18,24 +26,53 @@ typedef struct Queue {
  * Returns a pointer to the queue or NULL on failure
  */
 Queue *q_create() {
-    Queue *q = malloc(sizeof(Queue));
+    return q_create_with_allocator(NULL);
+}
+
+/*
+ * Same as q_create, but every allocation goes through the given allocator
+ * Passing NULL selects the default malloc-based allocator
+ */
+Queue *q_create_with_allocator(const Allocator *allocator) {
+    return q_create_with_policy(NULL, allocator);
+}
+
+/*
+ * Same as q_create_with_allocator, but sizing follows the given growth policy
+ * Passing NULL selects the defaults; returns NULL if the policy is invalid
+ */
+Queue *q_create_with_policy(const GrowthPolicy *policy, const Allocator *allocator) {
+    GrowthPolicy resolved;
+
+    if (growth_policy_resolve(&resolved, policy) != 0) {
+        return NULL;
+    }
+
+    if (!allocator) {
+        allocator = allocator_default();
+    }
+
+    Queue *q = allocator_alloc(allocator, sizeof(Queue));
 
     if (!q) {
         return NULL;
     }
 
-    q->data = malloc(DEFAULT_SIZE * sizeof(double));
+    q->policy = resolved;
+    q->allocator = *allocator;
+    q->data = allocator_alloc(allocator, resolved.initial_capacity * sizeof(double));
 
     if (!q->data) {
-        free(q); // Clean up the struct if the data array fails
+        allocator_free(allocator, q, sizeof(Queue)); // Clean up the struct if the data array fails
         return NULL;
     }
 
     // Initialize state for an empty queue starting at index 0
     q->head = 0;
     q->tail = 0;
-    q->capacity = DEFAULT_SIZE;
+    q->capacity = resolved.initial_capacity;
     q->size = 0;
+    STATS_INIT(q);
 
     return q;
 }
@@ -48,48 +85,119 @@ int q_free(Queue *q) {
         return -1;
     }
 
+    STATS_FREE(q, "queue");
+
+    Allocator allocator = q->allocator;
+
     if (q->data) {
-        free(q->data);
+        allocator_free(&allocator, q->data, q->capacity * sizeof(double));
         q->data = NULL;
     }
 
-    free(q);
+    allocator_free(&allocator, q, sizeof(Queue));
 
     return 0;
 }
 
 /*
- * Doubles the capacity of the queue when full
- * Realigns elements to start from index 0 in the new buffer
+ * Grows the ring in place with the allocator's realloc
+ * The old contents stay at [0...old capacity), so only one run of a wrapped
+ * queue has to move: [0...tail) to just past the old end when it fits and is
+ * the shorter run, otherwise [head...old end) to the very end of the new array
  */
-int q_resize(Queue *q) {
-    if (!q) {
+static int q_grow(Queue *q, size_t new_capacity) {
+    size_t old_capacity = q->capacity;
+    double *buffer = allocator_realloc(&q->allocator, q->data,
+                                       old_capacity * sizeof(double), new_capacity * sizeof(double));
+
+    if (!buffer) {
         return -1;
     }
 
+    size_t moved = 0;
+
+    q->data = buffer;
+    q->capacity = new_capacity;
+
+    if (q->size > 0 && q->head + q->size > old_capacity) {
+        size_t front_run = old_capacity - q->head;    // Elements in [head...old end)
+        size_t back_run = q->tail;                    // Elements wrapped to [0...tail)
+
+        if (back_run <= new_capacity - old_capacity && back_run <= front_run) {
+            memcpy(buffer + old_capacity, buffer, back_run * sizeof(double));
+            q->tail = (old_capacity + back_run) % new_capacity;
+            moved = back_run;
+        } else {
+            memmove(buffer + new_capacity - front_run, buffer + q->head, front_run * sizeof(double));
+            q->head = new_capacity - front_run;
+            moved = front_run;
+        }
+    } else {
+        q->tail = (q->head + q->size) % new_capacity;
+    }
+
+    STATS_RESIZE(q, "queue", moved * sizeof(double));
+
+    return 0;
+}
+
+/*
+ * Shrinks the ring in place, then hands the cut-off tail of the array back to the allocator
+ * A wrapped queue keeps [0...tail) and slides [head...end) down to end at the new capacity
+ */
+static int q_shrink(Queue *q, size_t new_capacity) {
     size_t old_capacity = q->capacity;
-    size_t new_capacity = q->capacity * 2;
+    size_t old_head = q->head;
+    size_t moved = 0;
+
+    if (q->head + q->size > old_capacity) {
+        size_t front_run = old_capacity - q->head;
+
+        q->head = new_capacity - front_run;
+        memmove(q->data + q->head, q->data + old_head, front_run * sizeof(double));
+        moved = front_run;
+    } else if (q->head + q->size > new_capacity) {
+        memmove(q->data, q->data + q->head, q->size * sizeof(double));
+        q->head = 0;
+        moved = q->size;
+    }
 
-    double *buffer = malloc(new_capacity * sizeof(double));
+    double *buffer = allocator_realloc(&q->allocator, q->data,
+                                       old_capacity * sizeof(double), new_capacity * sizeof(double));
 
     if (!buffer) {
+        // Put the elements back where the old capacity expects them
+        if (moved) {
+            memmove(q->data + old_head, q->data + q->head, moved * sizeof(double));
+            q->head = old_head;
+        }
         return -1;
     }
 
-    // Realign data, map [head...end] and [0...tail] to [0...size] in new buffer
-    for (size_t i = 0; i < q->size; i++) {
-        buffer[i] = q->data[(q->head + i) % old_capacity];
-    }
-
-    free(q->data); // Release old memory
     q->data = buffer;
-    q->head = 0; // Reset head to start of new buffer
-    q->tail = q->size; // Tail points to the first empty slot
     q->capacity = new_capacity;
+    q->tail = (q->head + q->size) % new_capacity;
+
+    STATS_RESIZE(q, "queue", moved * sizeof(double));
 
     return 0;
 }
 
+/*
+ * Grows or shrinks the queue's array to new_capacity, keeping every element
+ */
+int q_resize(Queue *q, size_t new_capacity) {
+    if (!q || new_capacity < q->size || new_capacity == 0) {
+        return -1;
+    }
+
+    if (new_capacity == q->capacity) {
+        return 0;
+    }
+
+    return new_capacity > q->capacity ? q_grow(q, new_capacity) : q_shrink(q, new_capacity);
+}
+
 /*
  * Adds an element to the back of the queue
  * Resizes if the queue array is full
@@ -99,9 +207,11 @@ int q_enqueue(Queue *q, double value) {
         return -1;
     }
 
+    STATS_TIMER_START();
+
     // Check if resize is needed
     if (q->size == q->capacity) {
-        if (q_resize(q) != 0) {
+        if (q_resize(q, growth_next(&q->policy, q->capacity)) != 0) {
             return -1;
         }
     }
@@ -111,6 +221,10 @@ int q_enqueue(Queue *q, double value) {
     q->tail = (q->tail + 1) % q->capacity;
     q->size++;
 
+    STATS_COUNT(q, inserts);
+    STATS_SIZE(q, q->size);
+    STATS_TIMER_STOP(q);
+
     return 0;
 }
 
@@ -127,12 +241,24 @@ double q_dequeue(Queue *q) {
         return NAN;
     }
 
+    STATS_TIMER_START();
+
     double dequeued_value = q->data[q->head];
 
     // Move head forward and wrap around using modulo
     q->head = (q->head + 1) % q->capacity;
     q->size--;
 
+    // Give memory back once the queue has drained well below capacity
+    size_t target = growth_shrink_target(&q->policy, q->size, q->capacity);
+    if (target) {
+        q_resize(q, target);
+    }
+
+    STATS_COUNT(q, removals);
+    STATS_SIZE(q, q->size);
+    STATS_TIMER_STOP(q);
+
     return dequeued_value;
 }
 
@@ -148,9 +274,44 @@ double q_peek(Queue *q) {
         return NAN;
     }
 
+    STATS_COUNT(q, lookups);
+
     return q->data[q->head];
 }
 
+/*
+ * Sums the elements or finds their minimum or maximum without dequeuing them
+ * The live elements form at most two runs, [head...end] and [0...tail], each scanned directly
+ * Returns NAN if the queue is empty
+ */
+double q_reduce(Queue *q, ReduceOp op) {
+    if (!q || q->size == 0) {
+        return NAN;
+    }
+
+    STATS_COUNT(q, lookups);
+
+    size_t first = q->capacity - q->head;
+
+    if (first > q->size) {
+        first = q->size;
+    }
+
+    size_t second = q->size - first;    // Elements that wrapped around to the front
+    const double *front = q->data + q->head;
+
+    switch (op) {
+        case REDUCE_SUM:
+            return simd_sum(front, first) + simd_sum(q->data, second);
+        case REDUCE_MIN:
+            return second ? fmin(simd_min(front, first), simd_min(q->data, second)) : simd_min(front, first);
+        case REDUCE_MAX:
+            return second ? fmax(simd_max(front, first), simd_max(q->data, second)) : simd_max(front, first);
+    }
+
+    return NAN;
+}
+
 /*
  * Prints all elements currently in the queue
  */
@@ -169,3 +330,63 @@ int q_print(Queue *q) {
 
     return 0;
 }
+
+/*
+ * Copies the queue's counters into *out
+ * Returns -1 if the library was built without LDS_STATS
+ */
+int q_stats(Queue *q, DsStats *out) {
+    if (!q || !out) {
+        return -1;
+    }
+
+    return STATS_COPY(q, out);
+}
+
+/*
+ * Writes the queue to fd as a binary image, front to back
+ * A wrapped ring goes out as its two runs in one writev, without realigning it first
+ */
+int q_write(Queue *q, int fd) {
+    if (!q) {
+        return -1;
+    }
+
+    size_t first = q->capacity - q->head;
+
+    if (first > q->size) {
+        first = q->size;
+    }
+
+    return serial_write_array(fd, SERIAL_QUEUE, q->data + q->head, first, q->data, q->size - first);
+}
+
+/*
+ * Loads an image written by q_write straight into an array sized to hold it
+ * Returns NULL if the image is malformed or truncated
+ */
+Queue *q_read(int fd) {
+    size_t count;
+
+    if (serial_read_header(fd, SERIAL_QUEUE, &count) != 0) {
+        return NULL;
+    }
+
+    GrowthPolicy policy = {count, 0.0, 0.0};
+    Queue *q = q_create_with_policy(&policy, NULL);
+
+    if (!q) {
+        return NULL;
+    }
+
+    if (serial_read_doubles(fd, q->data, count) != 0) {
+        q_free(q);
+        return NULL;
+    }
+
+    q->size = count;
+    q->tail = count % q->capacity;
+    STATS_SIZE(q, count);
+
+    return q;
+}
@@ -0,0 +1,242 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "functions.h"
+
+#define NUM_BUCKETS 65          // One bucket per possible highest differing bit, plus "equal"
+#define DEFAULT_BUCKET_SIZE 16  // The starting size of a bucket once it is first used
+
+// A key with the payload it carries
+typedef struct RadixEntry {
+    uint64_t key;
+    double value;
+} RadixEntry;
+
+// Dynamic array holding every entry whose key shares a bit prefix with 'last'
+typedef struct RadixBucket {
+    RadixEntry *data;
+    size_t size;
+    size_t capacity;
+} RadixBucket;
+
+/*
+ * Structure for a monotone radix min-heap keyed by uint64_t
+ * Bucket i holds keys whose highest bit differing from the last popped key is
+ * bit i - 1 (bucket 0 holds keys equal to it), so no two entries are ever compared
+ * Keys inserted must not be smaller than the last key popped
+ */
+typedef struct RadixHeap {
+    RadixBucket buckets[NUM_BUCKETS];
+    uint64_t last;  // Last key removed, the lower bound for every stored key
+    size_t size;    // Current number of elements
+} RadixHeap;
+
+/*
+ * Returns the bucket a key belongs in relative to the last popped key
+ */
+static inline size_t rh_bucket_index(uint64_t key, uint64_t last) {
+    uint64_t diff = key ^ last;
+    size_t index = 0;
+
+    if (diff == 0) {
+        return 0;
+    }
+
+#if defined(__GNUC__)
+    index = 64 - (size_t) __builtin_clzll(diff);
+#else
+    while (diff) {
+        diff >>= 1;
+        index++;
+    }
+#endif
+
+    return index;
+}
+
+/*
+ * Creates an empty radix heap
+ * Bucket arrays are allocated on first use
+ */
+RadixHeap *rh_create() {
+    RadixHeap *rh = calloc(1, sizeof(RadixHeap));
+
+    if (!rh) {
+        return NULL;
+    }
+
+    return rh;
+}
+
+/*
+ * Frees every bucket array and the heap structure
+ */
+int rh_free(RadixHeap *rh) {
+    if (!rh) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        free(rh->buckets[i].data);
+    }
+
+    free(rh);
+
+    return 0;
+}
+
+/*
+ * Makes sure a bucket can hold at least 'needed' entries
+ */
+static int rh_bucket_reserve(RadixBucket *bucket, size_t needed) {
+    if (needed <= bucket->capacity) {
+        return 0;
+    }
+
+    size_t new_capacity = bucket->capacity ? bucket->capacity : DEFAULT_BUCKET_SIZE;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+
+    RadixEntry *buffer = realloc(bucket->data, new_capacity * sizeof(RadixEntry));
+
+    if (!buffer) {
+        return -1;
+    }
+
+    bucket->data = buffer;
+    bucket->capacity = new_capacity;
+
+    return 0;
+}
+
+/*
+ * Inserts a key and its payload
+ * Returns -1 if the key is smaller than the last popped key
+ */
+int rh_insert(RadixHeap *rh, uint64_t key, double value) {
+    if (!rh || key < rh->last) {
+        return -1;
+    }
+
+    RadixBucket *bucket = &rh->buckets[rh_bucket_index(key, rh->last)];
+
+    if (rh_bucket_reserve(bucket, bucket->size + 1) != 0) {
+        return -1;
+    }
+
+    bucket->data[bucket->size].key = key;
+    bucket->data[bucket->size].value = value;
+    bucket->size++;
+    rh->size++;
+
+    return 0;
+}
+
+/*
+ * Makes sure bucket 0 holds the minimum key
+ * The first non-empty bucket is scanned for its smallest key, which becomes
+ * the new 'last', and its entries are redistributed into strictly lower buckets
+ * Returns -1 without changing anything if a target bucket cannot grow
+ */
+static int rh_refill(RadixHeap *rh) {
+    if (rh->buckets[0].size > 0) {
+        return 0;
+    }
+
+    size_t i = 1;
+    while (rh->buckets[i].size == 0) {
+        i++;
+    }
+
+    RadixBucket *bucket = &rh->buckets[i];
+    uint64_t new_last = bucket->data[0].key;
+
+    for (size_t j = 1; j < bucket->size; j++) {
+        if (bucket->data[j].key < new_last) {
+            new_last = bucket->data[j].key;
+        }
+    }
+
+    // Count where each entry will land so every target can be grown up front
+    size_t incoming[NUM_BUCKETS] = {0};
+
+    for (size_t j = 0; j < bucket->size; j++) {
+        incoming[rh_bucket_index(bucket->data[j].key, new_last)]++;
+    }
+
+    for (size_t b = 0; b < i; b++) {
+        if (rh_bucket_reserve(&rh->buckets[b], rh->buckets[b].size + incoming[b]) != 0) {
+            return -1;
+        }
+    }
+
+    rh->last = new_last;
+
+    // Every entry shares more leading bits with the new last, so it lands below i
+    for (size_t j = 0; j < bucket->size; j++) {
+        RadixEntry *entry = &bucket->data[j];
+        RadixBucket *target = &rh->buckets[rh_bucket_index(entry->key, new_last)];
+        target->data[target->size++] = *entry;
+    }
+
+    bucket->size = 0;
+
+    return 0;
+}
+
+/*
+ * Returns the value with the smallest key without removing it
+ * The key is written to *key if it is not NULL
+ */
+double rh_peek(RadixHeap *rh, uint64_t *key) {
+    if (!rh || rh->size == 0) {
+        return NAN;
+    }
+
+    if (rh_refill(rh) != 0) {
+        return NAN;
+    }
+
+    RadixBucket *bucket = &rh->buckets[0];
+
+    if (key) {
+        *key = bucket->data[bucket->size - 1].key;
+    }
+
+    return bucket->data[bucket->size - 1].value;
+}
+
+/*
+ * Removes and returns the value with the smallest key
+ * The key is written to *key if it is not NULL
+ */
+double rh_pop_min(RadixHeap *rh, uint64_t *key) {
+    if (!rh || rh->size == 0) {
+        return NAN;
+    }
+
+    if (rh_refill(rh) != 0) {
+        return NAN;
+    }
+
+    RadixBucket *bucket = &rh->buckets[0];
+    RadixEntry *entry = &bucket->data[--bucket->size];
+
+    if (key) {
+        *key = entry->key;
+    }
+
+    rh->size--;
+
+    return entry->value;
+}
+
+/*
+ * Returns the number of elements in the heap
+ */
+size_t rh_size(RadixHeap *rh) {
+    return rh ? rh->size : 0;
+}
@@ -0,0 +1,210 @@
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "serialize_internal.h"
+
+#define SERIAL_CHUNK 512    // Doubles converted per write on big-endian hosts
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define SERIAL_SWAP 1
+#endif
+
+static const unsigned char serial_magic[4] = {'L', 'D', 'S', 'B'};
+
+static void serial_put(unsigned char *out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = (unsigned char) (value >> (8 * i));
+    }
+}
+
+static uint64_t serial_get(const unsigned char *in, size_t bytes) {
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < bytes; i++) {
+        value |= (uint64_t) in[i] << (8 * i);
+    }
+
+    return value;
+}
+
+static void serial_encode_header(unsigned char *header, SerialKind kind, uint64_t count) {
+    memcpy(header, serial_magic, sizeof(serial_magic));
+    serial_put(header + 4, SERIAL_VERSION, 2);
+    serial_put(header + 6, (uint64_t) kind, 2);
+    serial_put(header + 8, count, 8);
+}
+
+/*
+ * Keeps calling writev until every byte is out, advancing past partial writes
+ */
+static int serial_writev_all(int fd, struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        size_t left = (size_t) written;
+
+        while (count > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            iov++;
+            count--;
+        }
+
+        if (count > 0) {
+            iov->iov_base = (char *) iov->iov_base + left;
+            iov->iov_len -= left;
+        }
+    }
+
+    return 0;
+}
+
+#ifdef SERIAL_SWAP
+static void serial_swap(double *data, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint64_t bits;
+        memcpy(&bits, &data[i], sizeof(bits));
+        bits = __builtin_bswap64(bits);
+        memcpy(&data[i], &bits, sizeof(bits));
+    }
+}
+#endif
+
+/*
+ * Writes the header for count elements
+ */
+int serial_write_header(int fd, SerialKind kind, uint64_t count) {
+    unsigned char header[SERIAL_HEADER_SIZE];
+    serial_encode_header(header, kind, count);
+
+    struct iovec iov = {header, sizeof(header)};
+    return serial_writev_all(fd, &iov, 1);
+}
+
+/*
+ * Writes count doubles in little-endian order
+ */
+int serial_write_doubles(int fd, const double *data, size_t count) {
+#ifdef SERIAL_SWAP
+    double chunk[SERIAL_CHUNK];
+
+    while (count > 0) {
+        size_t n = count < SERIAL_CHUNK ? count : SERIAL_CHUNK;
+        memcpy(chunk, data, n * sizeof(double));
+        serial_swap(chunk, n);
+
+        struct iovec iov = {chunk, n * sizeof(double)};
+        if (serial_writev_all(fd, &iov, 1) != 0) {
+            return -1;
+        }
+
+        data += n;
+        count -= n;
+    }
+
+    return 0;
+#else
+    struct iovec iov = {(void *) data, count * sizeof(double)};
+    return serial_writev_all(fd, &iov, 1);
+#endif
+}
+
+/*
+ * Writes a whole image whose elements sit in at most two runs of memory
+ */
+int serial_write_array(int fd, SerialKind kind, const double *first, size_t first_count,
+                       const double *second, size_t second_count) {
+#ifdef SERIAL_SWAP
+    if (serial_write_header(fd, kind, first_count + second_count) != 0 ||
+        serial_write_doubles(fd, first, first_count) != 0) {
+        return -1;
+    }
+    return serial_write_doubles(fd, second, second_count);
+#else
+    unsigned char header[SERIAL_HEADER_SIZE];
+    serial_encode_header(header, kind, first_count + second_count);
+
+    struct iovec iov[3] = {
+        {header, sizeof(header)},
+        {(void *) first, first_count * sizeof(double)},
+        {(void *) second, second_count * sizeof(double)}
+    };
+
+    return serial_writev_all(fd, iov, second_count > 0 ? 3 : 2);
+#endif
+}
+
+/*
+ * Reads exactly size bytes; a short file is an error
+ */
+static int serial_read_all(int fd, void *buffer, size_t size) {
+    char *out = buffer;
+
+    while (size > 0) {
+        ssize_t got = read(fd, out, size);
+
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (got == 0) {
+            return -1;
+        }
+
+        out += got;
+        size -= (size_t) got;
+    }
+
+    return 0;
+}
+
+/*
+ * Reads and checks a header, rejecting other formats, versions, kinds and impossible counts
+ */
+int serial_read_header(int fd, SerialKind kind, size_t *count) {
+    unsigned char header[SERIAL_HEADER_SIZE];
+
+    if (serial_read_all(fd, header, sizeof(header)) != 0) {
+        return -1;
+    }
+
+    if (memcmp(header, serial_magic, sizeof(serial_magic)) != 0 ||
+        serial_get(header + 4, 2) != SERIAL_VERSION ||
+        serial_get(header + 6, 2) != (uint64_t) kind) {
+        return -1;
+    }
+
+    uint64_t stored = serial_get(header + 8, 8);
+
+    if (stored > SIZE_MAX / sizeof(double)) {
+        return -1;
+    }
+
+    *count = (size_t) stored;
+    return 0;
+}
+
+/*
+ * Reads count little-endian doubles into data
+ */
+int serial_read_doubles(int fd, double *data, size_t count) {
+    if (serial_read_all(fd, data, count * sizeof(double)) != 0) {
+        return -1;
+    }
+
+#ifdef SERIAL_SWAP
+    serial_swap(data, count);
+#endif
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef SERIALIZE_INTERNAL_H
+#define SERIALIZE_INTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Binary image shared by every structure's write and read functions, all fields little-endian:
+ *   magic "LDSB" (4 bytes), format version (u16), structure kind (u16),
+ *   element count (u64), then count IEEE-754 doubles in the order below
+ */
+
+#define SERIAL_VERSION 1
+#define SERIAL_HEADER_SIZE 16
+
+// Which structure an image holds, and so what order its elements are in
+typedef enum SerialKind {
+    SERIAL_STACK = 1,       // Bottom to top
+    SERIAL_QUEUE = 2,       // Front to back
+    SERIAL_LINKED_LIST = 3, // Head to tail
+    SERIAL_HEAP = 4,        // Max-heap array layout, loaded as is
+    SERIAL_MIN_HEAP = 5     // Min-heap array layout, loaded as is
+} SerialKind;
+
+// Writes the header and up to two runs of doubles; one writev on little-endian hosts
+int serial_write_array(int fd, SerialKind kind, const double *first, size_t first_count,
+                       const double *second, size_t second_count);
+
+// Writes only the header, for structures that stream their elements with serial_write_doubles
+int serial_write_header(int fd, SerialKind kind, uint64_t count);
+int serial_write_doubles(int fd, const double *data, size_t count);
+
+// Checks the header against the expected kind and returns the element count
+int serial_read_header(int fd, SerialKind kind, size_t *count);
+
+// Reads count doubles straight into data, converting in place on big-endian hosts
+int serial_read_doubles(int fd, double *data, size_t count);
+
+#endif
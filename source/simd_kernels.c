@@ -0,0 +1,446 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simd_kernels.h"
+
+// The vector paths need x86 intrinsics and per-function target attributes (GCC/Clang)
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// One implementation of every kernel
+typedef struct SimdKernels {
+    const char *name;
+    double (*sum)(const double *data, size_t n);
+    double (*min)(const double *data, size_t n);
+    double (*max)(const double *data, size_t n);
+    size_t (*count_above)(const double *data, size_t n, double threshold);
+    size_t (*count_below)(const double *data, size_t n, double threshold);
+    size_t (*find)(const double *data, size_t n, double value);
+} SimdKernels;
+
+/* ---------- Scalar fallback ---------- */
+
+static double scalar_sum(const double *data, size_t n) {
+    double total = 0.0;
+
+    for (size_t i = 0; i < n; i++) {
+        total += data[i];
+    }
+
+    return total;
+}
+
+static double scalar_min(const double *data, size_t n) {
+    if (n == 0) {
+        return NAN;
+    }
+
+    double best = data[0];
+
+    for (size_t i = 1; i < n; i++) {
+        if (data[i] < best) {
+            best = data[i];
+        }
+    }
+
+    return best;
+}
+
+static double scalar_max(const double *data, size_t n) {
+    if (n == 0) {
+        return NAN;
+    }
+
+    double best = data[0];
+
+    for (size_t i = 1; i < n; i++) {
+        if (data[i] > best) {
+            best = data[i];
+        }
+    }
+
+    return best;
+}
+
+static size_t scalar_count_above(const double *data, size_t n, double threshold) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        count += data[i] > threshold;
+    }
+
+    return count;
+}
+
+static size_t scalar_count_below(const double *data, size_t n, double threshold) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        count += data[i] < threshold;
+    }
+
+    return count;
+}
+
+static size_t scalar_find(const double *data, size_t n, double value) {
+    for (size_t i = 0; i < n; i++) {
+        if (data[i] == value) {
+            return i;
+        }
+    }
+
+    return n;
+}
+
+static const SimdKernels scalar_kernels = {
+    "scalar", scalar_sum, scalar_min, scalar_max, scalar_count_above, scalar_count_below, scalar_find
+};
+
+#ifdef SIMD_X86
+
+/* ---------- AVX2 (4 doubles per vector) ---------- */
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static double avx2_horizontal_sum(__m256d v) {
+    __m128d half = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+}
+
+AVX2 static double avx2_sum(const double *data, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+
+    // Two independent accumulators hide the latency of the add
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(data + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(data + i + 4));
+    }
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(data + i));
+    }
+
+    double total = avx2_horizontal_sum(_mm256_add_pd(acc0, acc1));
+
+    for (; i < n; i++) {
+        total += data[i];
+    }
+
+    return total;
+}
+
+AVX2 static double avx2_min(const double *data, size_t n) {
+    if (n < 4) {
+        return scalar_min(data, n);
+    }
+
+    __m256d acc = _mm256_loadu_pd(data);
+    size_t i = 4;
+
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm256_min_pd(acc, _mm256_loadu_pd(data + i));
+    }
+
+    __m128d half = _mm_min_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    double best = _mm_cvtsd_f64(_mm_min_sd(half, _mm_unpackhi_pd(half, half)));
+
+    for (; i < n; i++) {
+        if (data[i] < best) {
+            best = data[i];
+        }
+    }
+
+    return best;
+}
+
+AVX2 static double avx2_max(const double *data, size_t n) {
+    if (n < 4) {
+        return scalar_max(data, n);
+    }
+
+    __m256d acc = _mm256_loadu_pd(data);
+    size_t i = 4;
+
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm256_max_pd(acc, _mm256_loadu_pd(data + i));
+    }
+
+    __m128d half = _mm_max_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    double best = _mm_cvtsd_f64(_mm_max_sd(half, _mm_unpackhi_pd(half, half)));
+
+    for (; i < n; i++) {
+        if (data[i] > best) {
+            best = data[i];
+        }
+    }
+
+    return best;
+}
+
+AVX2 static size_t avx2_count_above(const double *data, size_t n, double threshold) {
+    __m256d limit = _mm256_set1_pd(threshold);
+    size_t count = 0;
+    size_t i = 0;
+
+    // Each comparison yields a 4-bit lane mask; popcount adds up the matches
+    for (; i + 4 <= n; i += 4) {
+        __m256d above = _mm256_cmp_pd(_mm256_loadu_pd(data + i), limit, _CMP_GT_OQ);
+        count += (size_t) __builtin_popcount((unsigned) _mm256_movemask_pd(above));
+    }
+
+    return count + scalar_count_above(data + i, n - i, threshold);
+}
+
+AVX2 static size_t avx2_count_below(const double *data, size_t n, double threshold) {
+    __m256d limit = _mm256_set1_pd(threshold);
+    size_t count = 0;
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m256d below = _mm256_cmp_pd(_mm256_loadu_pd(data + i), limit, _CMP_LT_OQ);
+        count += (size_t) __builtin_popcount((unsigned) _mm256_movemask_pd(below));
+    }
+
+    return count + scalar_count_below(data + i, n - i, threshold);
+}
+
+AVX2 static size_t avx2_find(const double *data, size_t n, double value) {
+    __m256d target = _mm256_set1_pd(value);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m256d equal = _mm256_cmp_pd(_mm256_loadu_pd(data + i), target, _CMP_EQ_OQ);
+        int mask = _mm256_movemask_pd(equal);
+        if (mask) {
+            return i + (size_t) __builtin_ctz((unsigned) mask);
+        }
+    }
+
+    return i + scalar_find(data + i, n - i, value);
+}
+
+static const SimdKernels avx2_kernels = {
+    "avx2", avx2_sum, avx2_min, avx2_max, avx2_count_above, avx2_count_below, avx2_find
+};
+
+/* ---------- AVX-512F (8 doubles per vector) ---------- */
+
+#define AVX512 __attribute__((target("avx512f")))
+
+AVX512 static double avx512_sum(const double *data, size_t n) {
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_add_pd(acc0, _mm512_loadu_pd(data + i));
+        acc1 = _mm512_add_pd(acc1, _mm512_loadu_pd(data + i + 8));
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm512_add_pd(acc0, _mm512_loadu_pd(data + i));
+    }
+
+    double total = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+
+    for (; i < n; i++) {
+        total += data[i];
+    }
+
+    return total;
+}
+
+AVX512 static double avx512_min(const double *data, size_t n) {
+    if (n < 8) {
+        return scalar_min(data, n);
+    }
+
+    __m512d acc = _mm512_loadu_pd(data);
+    size_t i = 8;
+
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm512_min_pd(acc, _mm512_loadu_pd(data + i));
+    }
+
+    double best = _mm512_reduce_min_pd(acc);
+
+    for (; i < n; i++) {
+        if (data[i] < best) {
+            best = data[i];
+        }
+    }
+
+    return best;
+}
+
+AVX512 static double avx512_max(const double *data, size_t n) {
+    if (n < 8) {
+        return scalar_max(data, n);
+    }
+
+    __m512d acc = _mm512_loadu_pd(data);
+    size_t i = 8;
+
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm512_max_pd(acc, _mm512_loadu_pd(data + i));
+    }
+
+    double best = _mm512_reduce_max_pd(acc);
+
+    for (; i < n; i++) {
+        if (data[i] > best) {
+            best = data[i];
+        }
+    }
+
+    return best;
+}
+
+AVX512 static size_t avx512_count_above(const double *data, size_t n, double threshold) {
+    __m512d limit = _mm512_set1_pd(threshold);
+    size_t count = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __mmask8 above = _mm512_cmp_pd_mask(_mm512_loadu_pd(data + i), limit, _CMP_GT_OQ);
+        count += (size_t) __builtin_popcount((unsigned) above);
+    }
+
+    // The tail uses a masked load so nothing past the end is read
+    if (i < n) {
+        __mmask8 tail = (__mmask8) ((1u << (n - i)) - 1);
+        __mmask8 above = _mm512_mask_cmp_pd_mask(tail, _mm512_maskz_loadu_pd(tail, data + i), limit, _CMP_GT_OQ);
+        count += (size_t) __builtin_popcount((unsigned) above);
+    }
+
+    return count;
+}
+
+AVX512 static size_t avx512_count_below(const double *data, size_t n, double threshold) {
+    __m512d limit = _mm512_set1_pd(threshold);
+    size_t count = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __mmask8 below = _mm512_cmp_pd_mask(_mm512_loadu_pd(data + i), limit, _CMP_LT_OQ);
+        count += (size_t) __builtin_popcount((unsigned) below);
+    }
+
+    if (i < n) {
+        __mmask8 tail = (__mmask8) ((1u << (n - i)) - 1);
+        __mmask8 below = _mm512_mask_cmp_pd_mask(tail, _mm512_maskz_loadu_pd(tail, data + i), limit, _CMP_LT_OQ);
+        count += (size_t) __builtin_popcount((unsigned) below);
+    }
+
+    return count;
+}
+
+AVX512 static size_t avx512_find(const double *data, size_t n, double value) {
+    __m512d target = _mm512_set1_pd(value);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __mmask8 equal = _mm512_cmp_pd_mask(_mm512_loadu_pd(data + i), target, _CMP_EQ_OQ);
+        if (equal) {
+            return i + (size_t) __builtin_ctz((unsigned) equal);
+        }
+    }
+
+    if (i < n) {
+        __mmask8 tail = (__mmask8) ((1u << (n - i)) - 1);
+        __mmask8 equal = _mm512_mask_cmp_pd_mask(tail, _mm512_maskz_loadu_pd(tail, data + i), target, _CMP_EQ_OQ);
+        if (equal) {
+            return i + (size_t) __builtin_ctz((unsigned) equal);
+        }
+    }
+
+    return n;
+}
+
+static const SimdKernels avx512_kernels = {
+    "avx512", avx512_sum, avx512_min, avx512_max, avx512_count_above, avx512_count_below, avx512_find
+};
+
+#endif
+
+/* ---------- Dispatch ---------- */
+
+static const SimdKernels *kernels = &scalar_kernels;
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Picks the widest supported implementation, capped by LDS_SIMD if it is set
+ */
+static void simd_select() {
+#ifdef SIMD_X86
+    const char *cap = getenv("LDS_SIMD");
+    int allow_avx512 = !cap || strcmp(cap, "avx512") == 0;
+    int allow_avx2 = allow_avx512 || strcmp(cap, "avx2") == 0;
+
+    __builtin_cpu_init();
+
+    if (allow_avx512 && __builtin_cpu_supports("avx512f")) {
+        kernels = &avx512_kernels;
+    } else if (allow_avx2 && __builtin_cpu_supports("avx2")) {
+        kernels = &avx2_kernels;
+    }
+#endif
+}
+
+static const SimdKernels *simd_kernels() {
+    pthread_once(&kernels_once, simd_select);
+    return kernels;
+}
+
+/*
+ * Adds up n doubles; the vector paths sum in a different order, so the last bits may differ from a plain loop
+ */
+double simd_sum(const double *data, size_t n) {
+    return simd_kernels()->sum(data, n);
+}
+
+/*
+ * Returns the smallest of n doubles
+ */
+double simd_min(const double *data, size_t n) {
+    return simd_kernels()->min(data, n);
+}
+
+/*
+ * Returns the largest of n doubles
+ */
+double simd_max(const double *data, size_t n) {
+    return simd_kernels()->max(data, n);
+}
+
+/*
+ * Counts the values strictly greater than threshold
+ */
+size_t simd_count_above(const double *data, size_t n, double threshold) {
+    return simd_kernels()->count_above(data, n, threshold);
+}
+
+/*
+ * Counts the values strictly less than threshold
+ */
+size_t simd_count_below(const double *data, size_t n, double threshold) {
+    return simd_kernels()->count_below(data, n, threshold);
+}
+
+/*
+ * Returns the index of the first value equal to value, or n
+ */
+size_t simd_find(const double *data, size_t n, double value) {
+    return simd_kernels()->find(data, n, value);
+}
+
+/*
+ * Names the implementation selected for this process
+ */
+const char *simd_level() {
+    return simd_kernels()->name;
+}
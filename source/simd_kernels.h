@@ -0,0 +1,23 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <stddef.h>
+
+/*
+ * Read-only kernels over contiguous double arrays
+ * The first call picks the widest implementation the CPU supports (AVX-512F,
+ * AVX2 or plain C); setting LDS_SIMD=scalar|avx2|avx512 in the environment
+ * caps that choice, which is mainly useful for benchmarking
+ */
+
+double simd_sum(const double *data, size_t n);
+double simd_min(const double *data, size_t n);      // NAN if n is 0
+double simd_max(const double *data, size_t n);      // NAN if n is 0
+size_t simd_count_above(const double *data, size_t n, double threshold);
+size_t simd_count_below(const double *data, size_t n, double threshold);
+size_t simd_find(const double *data, size_t n, double value);   // n if not found
+
+// Name of the implementation in use, "scalar", "avx2" or "avx512"
+const char *simd_level();
+
+#endif
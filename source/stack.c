@@ -1,14 +1,22 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
-#define DEFAULT_SIZE 100    // The starting size for the dynamic stack array
+#include "functions.h"
+#include "growth_internal.h"
+#include "serialize_internal.h"
+#include "simd_kernels.h"
+#include "stats_internal.h"
 
 // Structure for a dynamic array-based stack
 typedef struct Stack {
     double *data;       // Pointer to the array holding stack elements
     size_t top;         // Index of the next available slot (also represents current count)
     size_t capacity;    // Total allocated size of the data array
+    GrowthPolicy policy;    // Initial capacity, growth factor and shrink threshold
+    Allocator allocator;    // Source of every allocation made for this stack
+    STATS_FIELD             // Operation counters, only present when built with LDS_STATS
 } Stack;
 
 /*
@@ -16,21 +24,50 @@ typedef struct Stack {
  * Returns the stack pointer or NULL on failure
  */
 Stack *s_create() {
-    Stack *s = malloc(sizeof(Stack));
+    return s_create_with_allocator(NULL);
+}
+
+/*
+ * Same as s_create, but every allocation goes through the given allocator
+ * Passing NULL selects the default malloc-based allocator
+ */
+Stack *s_create_with_allocator(const Allocator *allocator) {
+    return s_create_with_policy(NULL, allocator);
+}
+
+/*
+ * Same as s_create_with_allocator, but sizing follows the given growth policy
+ * Passing NULL selects the defaults; returns NULL if the policy is invalid
+ */
+Stack *s_create_with_policy(const GrowthPolicy *policy, const Allocator *allocator) {
+    GrowthPolicy resolved;
+
+    if (growth_policy_resolve(&resolved, policy) != 0) {
+        return NULL;
+    }
+
+    if (!allocator) {
+        allocator = allocator_default();
+    }
+
+    Stack *s = allocator_alloc(allocator, sizeof(Stack));
 
     if (!s) {
         return NULL;
     }
 
-    s->data = malloc(DEFAULT_SIZE * sizeof(double));
+    s->policy = resolved;
+    s->allocator = *allocator;
+    s->data = allocator_alloc(allocator, resolved.initial_capacity * sizeof(double));
 
     if (!s->data) {
-        free(s);    // Clean up the struct if the array allocation fails
+        allocator_free(allocator, s, sizeof(Stack));    // Clean up the struct if the array allocation fails
         return NULL;
     }
 
     s->top = 0; // Stack starts empty
-    s->capacity = DEFAULT_SIZE;
+    s->capacity = resolved.initial_capacity;
+    STATS_INIT(s);
 
     return s;
 }
@@ -43,34 +80,38 @@ int s_free(Stack *s) {
         return -1;
     }
 
+    STATS_FREE(s, "stack");
+
+    Allocator allocator = s->allocator;
+
     if (s->data) {
-        free(s->data);
+        allocator_free(&allocator, s->data, s->capacity * sizeof(double));
         s->data = NULL;
     }
 
-    free(s);
+    allocator_free(&allocator, s, sizeof(Stack));
 
     return 0;
 }
 
 /*
- * Doubles the capacity of the stack using realloc
+ * Grows or shrinks the array to new_capacity using the allocator's realloc
  * realloc handles copying the old data to the new location
  */
-int s_resize(Stack *s) {
-    if (!s) {
+int s_resize(Stack *s, size_t new_capacity) {
+    if (!s || new_capacity < s->top || new_capacity == 0) {
         return -1;
     }
 
-    size_t new_capacity = s->capacity * 2;
-
     // realloc attempts to resize the existing block or move it if needed
-    double *buffer = realloc(s->data, new_capacity * sizeof(double));
+    double *buffer = allocator_realloc(&s->allocator, s->data,
+                                       s->capacity * sizeof(double), new_capacity * sizeof(double));
 
     if (buffer == NULL) {
         return -1;
     }
 
+    STATS_RESIZE(s, "stack", s->top * sizeof(double));
     s->data = buffer;
     s->capacity = new_capacity;
 
@@ -86,9 +127,11 @@ int s_push(Stack *s, double value) {
         return -1;
     }
 
+    STATS_TIMER_START();
+
     // Check if the stack is full
     if (s->top >= s->capacity) {
-        if (s_resize(s) != 0) {
+        if (s_resize(s, growth_next(&s->policy, s->capacity)) != 0) {
             return -1;
         }
     }
@@ -96,6 +139,10 @@ int s_push(Stack *s, double value) {
     // Assign value then increment top (post-increment)
     s->data[s->top++] = value;
 
+    STATS_COUNT(s, inserts);
+    STATS_SIZE(s, s->top);
+    STATS_TIMER_STOP(s);
+
     return 0;
 }
 
@@ -112,8 +159,22 @@ double s_pop(Stack *s) {
         return NAN;
     }
 
+    STATS_TIMER_START();
+
     // Decrement top then return the value at that index (pre-decrement)
-    return s->data[--s->top];
+    double value = s->data[--s->top];
+
+    // Give memory back once the stack has drained well below capacity
+    size_t target = growth_shrink_target(&s->policy, s->top, s->capacity);
+    if (target) {
+        s_resize(s, target);
+    }
+
+    STATS_COUNT(s, removals);
+    STATS_SIZE(s, s->top);
+    STATS_TIMER_STOP(s);
+
+    return value;
 }
 
 /*
@@ -128,10 +189,51 @@ double s_peek(Stack *s) {
         return NAN;
     }
 
+    STATS_COUNT(s, lookups);
+
     // Peek at the last inserted element
     return s->data[s->top - 1];
 }
 
+/*
+ * Sums the elements or finds their minimum or maximum without popping them
+ * Returns NAN if the stack is empty
+ */
+double s_reduce(Stack *s, ReduceOp op) {
+    if (!s || s->top == 0) {
+        return NAN;
+    }
+
+    STATS_COUNT(s, lookups);
+
+    switch (op) {
+        case REDUCE_SUM:
+            return simd_sum(s->data, s->top);
+        case REDUCE_MIN:
+            return simd_min(s->data, s->top);
+        case REDUCE_MAX:
+            return simd_max(s->data, s->top);
+    }
+
+    return NAN;
+}
+
+/*
+ * Returns the position (0 = bottom) of the first element equal to value
+ * Returns S_NOT_FOUND if no element matches
+ */
+size_t s_find(Stack *s, double value) {
+    if (!s) {
+        return S_NOT_FOUND;
+    }
+
+    STATS_COUNT(s, lookups);
+
+    size_t index = simd_find(s->data, s->top, value);
+
+    return index < s->top ? index : S_NOT_FOUND;
+}
+
 /*
  * Iterate through the stack, printing elements from bottom to top
  */
@@ -150,3 +252,55 @@ int s_print(Stack *s) {
 
     return -1;
 }
+
+/*
+ * Copies the stack's counters into *out
+ * Returns -1 if the library was built without LDS_STATS
+ */
+int s_stats(Stack *s, DsStats *out) {
+    if (!s || !out) {
+        return -1;
+    }
+
+    return STATS_COPY(s, out);
+}
+
+/*
+ * Writes the stack to fd as a binary image, bottom to top, with a single writev
+ */
+int s_write(Stack *s, int fd) {
+    if (!s) {
+        return -1;
+    }
+
+    return serial_write_array(fd, SERIAL_STACK, s->data, s->top, NULL, 0);
+}
+
+/*
+ * Loads an image written by s_write straight into an array sized to hold it
+ * Returns NULL if the image is malformed or truncated
+ */
+Stack *s_read(int fd) {
+    size_t count;
+
+    if (serial_read_header(fd, SERIAL_STACK, &count) != 0) {
+        return NULL;
+    }
+
+    GrowthPolicy policy = {count, 0.0, 0.0};
+    Stack *s = s_create_with_policy(&policy, NULL);
+
+    if (!s) {
+        return NULL;
+    }
+
+    if (serial_read_doubles(fd, s->data, count) != 0) {
+        s_free(s);
+        return NULL;
+    }
+
+    s->top = count;
+    STATS_SIZE(s, count);
+
+    return s;
+}
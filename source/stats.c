@@ -0,0 +1,102 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "stats_internal.h"
+
+// Installed by stats_set_hook before the library is shared between threads
+static DsStatsHook stats_hook = NULL;
+static void *stats_hook_context = NULL;
+
+static atomic_uint sample_every = 0;
+
+/*
+ * Installs the process-wide hook called on resizes and frees
+ */
+void stats_set_hook(DsStatsHook hook, void *context) {
+    stats_hook = hook;
+    stats_hook_context = context;
+}
+
+/*
+ * Sets how often calls are timed for the latency histogram (0 disables sampling)
+ */
+void stats_set_sample_rate(unsigned every) {
+    atomic_store(&sample_every, every);
+}
+
+#ifdef LDS_STATS
+
+// Calls left before this thread times its next operation
+static _Thread_local unsigned sample_countdown;
+
+static void stats_notify(const char *structure, const void *instance, DsStatsEvent event, const DsStats *stats) {
+    if (stats_hook) {
+        stats_hook(structure, instance, event, stats, stats_hook_context);
+    }
+}
+
+/*
+ * Counts a resize and reports it to the hook
+ */
+void stats_record_resize(DsStats *stats, const char *structure, const void *instance, uint64_t bytes) {
+    stats->resizes++;
+    stats->bytes_moved += bytes;
+    stats_notify(structure, instance, STATS_EVENT_RESIZE, stats);
+}
+
+/*
+ * Hands the final counters of an instance to the hook
+ */
+void stats_record_free(DsStats *stats, const char *structure, const void *instance) {
+    stats_notify(structure, instance, STATS_EVENT_FREE, stats);
+}
+
+static uint64_t stats_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+/*
+ * Returns a start timestamp if this call is sampled, or 0 if it is not
+ */
+uint64_t stats_sample_begin() {
+    unsigned every = atomic_load_explicit(&sample_every, memory_order_relaxed);
+
+    if (every == 0) {
+        return 0;
+    }
+
+    if (sample_countdown > 1) {
+        sample_countdown--;
+        return 0;
+    }
+
+    sample_countdown = every;
+    return stats_now_ns();
+}
+
+/*
+ * Adds a sampled call's latency to the instance's log2 histogram
+ */
+void stats_sample_end(DsStats *stats, uint64_t start) {
+    if (start == 0) {
+        return;
+    }
+
+    uint64_t elapsed = stats_now_ns() - start;
+    size_t bucket = 0;
+
+    while (elapsed > 1 && bucket < STATS_LATENCY_BUCKETS - 1) {
+        elapsed >>= 1;
+        bucket++;
+    }
+
+    stats->latency_ns[bucket]++;
+    stats->latency_samples++;
+}
+
+#endif
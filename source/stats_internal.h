@@ -0,0 +1,59 @@
+#ifndef STATS_INTERNAL_H
+#define STATS_INTERNAL_H
+
+#include "stats.h"
+
+/*
+ * Instrumentation macros used inside the structure implementations
+ * Without LDS_STATS they expand to nothing, so the structs carry no counters
+ * and the hot paths contain no extra instructions
+ */
+
+#ifdef LDS_STATS
+
+void stats_record_resize(DsStats *stats, const char *structure, const void *instance, uint64_t bytes);
+void stats_record_free(DsStats *stats, const char *structure, const void *instance);
+uint64_t stats_sample_begin();
+void stats_sample_end(DsStats *stats, uint64_t start);
+
+static inline void stats_record_probe(DsStats *stats, uint64_t length) {
+    stats->probes += length;
+    if (length > stats->max_probe) {
+        stats->max_probe = length;
+    }
+}
+
+static inline void stats_record_size(DsStats *stats, size_t size) {
+    stats->size = size;
+    if (size > stats->peak_size) {
+        stats->peak_size = size;
+    }
+}
+
+#define STATS_FIELD DsStats stats;
+#define STATS_INIT(obj) memset(&(obj)->stats, 0, sizeof(DsStats))
+#define STATS_COUNT(obj, field) ((obj)->stats.operations++, (obj)->stats.field++)
+#define STATS_PROBE(obj, length) stats_record_probe(&(obj)->stats, (length))
+#define STATS_SIZE(obj, n) stats_record_size(&(obj)->stats, (n))
+#define STATS_RESIZE(obj, name, bytes) stats_record_resize(&(obj)->stats, (name), (obj), (bytes))
+#define STATS_FREE(obj, name) stats_record_free(&(obj)->stats, (name), (obj))
+#define STATS_TIMER_START() uint64_t stats_start_ = stats_sample_begin()
+#define STATS_TIMER_STOP(obj) stats_sample_end(&(obj)->stats, stats_start_)
+#define STATS_COPY(obj, out) (*(out) = (obj)->stats, 0)
+
+#else
+
+#define STATS_FIELD
+#define STATS_INIT(obj) ((void) 0)
+#define STATS_COUNT(obj, field) ((void) 0)
+#define STATS_PROBE(obj, length) ((void) 0)
+#define STATS_SIZE(obj, n) ((void) 0)
+#define STATS_RESIZE(obj, name, bytes) ((void) (bytes))
+#define STATS_FREE(obj, name) ((void) 0)
+#define STATS_TIMER_START()
+#define STATS_TIMER_STOP(obj) ((void) 0)
+#define STATS_COPY(obj, out) ((void) (out), -1)
+
+#endif
+
+#endif
@@ -0,0 +1,451 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "functions.h"
+#include "parallel_internal.h"
+
+#define CACHE_LINE 64       // Workers are padded to this size to avoid false sharing
+#define STEAL_ROUNDS 4      // Full passes over the victims before a worker goes to sleep
+
+// One submitted call, freed by the worker that runs it
+typedef struct Task {
+    void (*function)(void *arg);
+    void *arg;
+    struct Task *next;      // Link in the injection queue
+} Task;
+
+typedef struct ThreadPool ThreadPool;
+
+// One worker thread and the deque it owns
+typedef struct Worker {
+    _Alignas(CACHE_LINE) WsDeque *deque;
+    ThreadPool *pool;
+    pthread_t thread;
+    uint64_t rng_state;     // xorshift state for picking victims
+} Worker;
+
+/*
+ * Structure for a work-stealing thread pool
+ * Tasks submitted by a worker go on that worker's own deque and need no lock; idle
+ * workers steal from random victims. Tasks submitted from outside the pool go on a
+ * small injection queue, the only place a lock is taken on the fast path
+ */
+typedef struct ThreadPool {
+    Worker *workers;
+    size_t count;
+    pthread_mutex_t lock;           // Guards the injection queue and the sleep/wake handshake
+    pthread_cond_t work_ready;      // Signalled when a task is queued and a worker sleeps
+    pthread_cond_t all_done;        // Broadcast when pending drops to zero
+    Task *inject_head;
+    Task *inject_tail;
+    _Atomic(size_t) injected;       // Tasks on the injection queue, checked before taking the lock
+    _Atomic(size_t) queued;         // Tasks queued but not yet taken by a worker
+    _Atomic(size_t) pending;        // Tasks submitted but not yet finished
+    _Atomic(size_t) sleepers;       // Workers waiting on work_ready
+    int shutdown;
+} ThreadPool;
+
+// The worker running on this thread, if the thread belongs to a pool
+static _Thread_local Worker *tp_current_worker;
+
+static uint64_t tp_random(Worker *worker) {
+    worker->rng_state ^= worker->rng_state << 13;
+    worker->rng_state ^= worker->rng_state >> 7;
+    worker->rng_state ^= worker->rng_state << 17;
+
+    return worker->rng_state;
+}
+
+/*
+ * Finds the next task for a worker: its own deque first (newest task, still hot in
+ * cache), then the injection queue, then the oldest task of a random victim
+ */
+static Task *tp_find_task(Worker *worker) {
+    ThreadPool *pool = worker->pool;
+    Task *task = wsd_pop(worker->deque);
+
+    if (task) {
+        return task;
+    }
+
+    if (atomic_load_explicit(&pool->queued, memory_order_relaxed) == 0) {
+        return NULL;
+    }
+
+    if (atomic_load_explicit(&pool->injected, memory_order_relaxed) > 0) {
+        pthread_mutex_lock(&pool->lock);
+        task = pool->inject_head;
+        if (task) {
+            pool->inject_head = task->next;
+            if (!pool->inject_head) {
+                pool->inject_tail = NULL;
+            }
+            atomic_fetch_sub_explicit(&pool->injected, 1, memory_order_relaxed);
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        if (task) {
+            return task;
+        }
+    }
+
+    for (size_t round = 0; round < STEAL_ROUNDS; round++) {
+        size_t start = (size_t) (tp_random(worker) % pool->count);
+
+        for (size_t i = 0; i < pool->count; i++) {
+            Worker *victim = &pool->workers[(start + i) % pool->count];
+
+            if (victim != worker && (task = wsd_steal(victim->deque)) != NULL) {
+                return task;
+            }
+        }
+
+        sched_yield();
+    }
+
+    return NULL;
+}
+
+/*
+ * Runs a task and wakes tp_wait callers if it was the last one outstanding
+ */
+static void tp_run(ThreadPool *pool, Task *task) {
+    atomic_fetch_sub(&pool->queued, 1);
+
+    task->function(task->arg);
+    free(task);
+
+    if (atomic_fetch_sub(&pool->pending, 1) == 1) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->all_done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void *tp_worker_main(void *arg) {
+    Worker *worker = arg;
+    ThreadPool *pool = worker->pool;
+
+    tp_current_worker = worker;
+
+    for (;;) {
+        Task *task = tp_find_task(worker);
+
+        if (task) {
+            tp_run(pool, task);
+            continue;
+        }
+
+        // Announce the sleep before re-checking queued; a submitter increments queued
+        // before checking sleepers, so one of the two always sees the other
+        pthread_mutex_lock(&pool->lock);
+        atomic_fetch_add(&pool->sleepers, 1);
+
+        while (!pool->shutdown && atomic_load(&pool->queued) == 0) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+
+        atomic_fetch_sub(&pool->sleepers, 1);
+        int shutdown = pool->shutdown && atomic_load(&pool->queued) == 0;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (shutdown) {
+            return NULL;
+        }
+    }
+}
+
+/*
+ * Releases the pool's locks and memory once no worker is running
+ */
+static void tp_destroy(ThreadPool *pool) {
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->all_done);
+    free(pool->workers);
+    free(pool);
+}
+
+/*
+ * Creates a pool of num_threads workers (one per online CPU if 0)
+ */
+ThreadPool *tp_create(size_t num_threads) {
+    if (num_threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = cpus > 0 ? (size_t) cpus : 1;
+    }
+
+    ThreadPool *pool = malloc(sizeof(ThreadPool));
+
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->workers = aligned_alloc(CACHE_LINE, num_threads * sizeof(Worker));
+
+    if (!pool->workers) {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->all_done, NULL);
+    pool->inject_head = NULL;
+    pool->inject_tail = NULL;
+    atomic_init(&pool->injected, 0);
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->pending, 0);
+    atomic_init(&pool->sleepers, 0);
+    pool->shutdown = 0;
+    pool->count = num_threads;
+
+    // Every deque exists before any worker starts, since workers steal from all of them
+    for (size_t i = 0; i < num_threads; i++) {
+        Worker *worker = &pool->workers[i];
+        worker->deque = wsd_create(0);
+        worker->pool = pool;
+        worker->rng_state = 0x9E3779B97F4A7C15ULL * (i + 1);
+
+        if (!worker->deque) {
+            while (i-- > 0) {
+                wsd_free(pool->workers[i].deque);
+            }
+            tp_destroy(pool);
+            return NULL;
+        }
+    }
+
+    for (size_t i = 0; i < num_threads; i++) {
+        if (pthread_create(&pool->workers[i].thread, NULL, tp_worker_main, &pool->workers[i]) != 0) {
+            // Stop and join the workers already started
+            pthread_mutex_lock(&pool->lock);
+            pool->shutdown = 1;
+            pthread_cond_broadcast(&pool->work_ready);
+            pthread_mutex_unlock(&pool->lock);
+
+            for (size_t j = 0; j < i; j++) {
+                pthread_join(pool->workers[j].thread, NULL);
+            }
+            for (size_t j = 0; j < num_threads; j++) {
+                wsd_free(pool->workers[j].deque);
+            }
+            tp_destroy(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+/*
+ * Waits for every submitted task, then stops the workers and frees the pool
+ * Must not be called from one of the pool's own tasks
+ */
+int tp_free(ThreadPool *pool) {
+    if (!pool) {
+        return -1;
+    }
+
+    tp_wait(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    // Workers may steal from any deque until they exit, so all are joined before any is freed
+    for (size_t i = 0; i < pool->count; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    for (size_t i = 0; i < pool->count; i++) {
+        wsd_free(pool->workers[i].deque);
+    }
+
+    tp_destroy(pool);
+
+    return 0;
+}
+
+/*
+ * Queues function(arg) to run on one of the pool's threads
+ * Called from a task, it goes on the calling worker's deque without taking a lock
+ * Returns -1 if the task cannot be allocated
+ */
+int tp_submit(ThreadPool *pool, void (*function)(void *arg), void *arg) {
+    if (!pool || !function) {
+        return -1;
+    }
+
+    Task *task = malloc(sizeof(Task));
+
+    if (!task) {
+        return -1;
+    }
+
+    task->function = function;
+    task->arg = arg;
+    task->next = NULL;
+
+    atomic_fetch_add(&pool->pending, 1);
+
+    Worker *worker = tp_current_worker;
+
+    if (worker && worker->pool == pool && wsd_push(worker->deque, task) == 0) {
+        atomic_fetch_add(&pool->queued, 1);
+
+        if (atomic_load(&pool->sleepers) == 0) {
+            return 0;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+    } else {
+        pthread_mutex_lock(&pool->lock);
+
+        if (pool->inject_tail) {
+            pool->inject_tail->next = task;
+        } else {
+            pool->inject_head = task;
+        }
+        pool->inject_tail = task;
+
+        atomic_fetch_add_explicit(&pool->injected, 1, memory_order_relaxed);
+        atomic_fetch_add(&pool->queued, 1);
+    }
+
+    pthread_cond_signal(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    return 0;
+}
+
+/*
+ * Blocks until every task submitted so far, and every task those tasks submit, has finished
+ * Must not be called from one of the pool's own tasks
+ */
+int tp_wait(ThreadPool *pool) {
+    if (!pool) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+
+    while (atomic_load(&pool->pending) > 0) {
+        pthread_cond_wait(&pool->all_done, &pool->lock);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return 0;
+}
+
+/*
+ * Returns the number of worker threads
+ */
+size_t tp_size(ThreadPool *pool) {
+    return pool ? pool->count : 0;
+}
+
+/*
+ * One parallel_for call, shared by its caller and the helper tasks it queues
+ * Freed by whichever of them lets go last, since a helper stuck behind unrelated
+ * work may only start after the caller has returned
+ */
+typedef struct ParallelBatch {
+    void (*body)(void *context, size_t task);
+    void *context;
+    size_t tasks;
+    atomic_size_t next;         // Next index nobody has claimed
+    atomic_size_t finished;     // Indices whose body has returned
+    atomic_size_t refs;         // The caller plus every queued helper
+    pthread_mutex_t lock;
+    pthread_cond_t done;        // Signalled when finished reaches tasks
+} ParallelBatch;
+
+/*
+ * Claims and runs indices until none are left
+ */
+static void parallel_drain(ParallelBatch *batch) {
+    size_t task;
+
+    while ((task = atomic_fetch_add(&batch->next, 1)) < batch->tasks) {
+        batch->body(batch->context, task);
+
+        if (atomic_fetch_add(&batch->finished, 1) + 1 == batch->tasks) {
+            pthread_mutex_lock(&batch->lock);
+            pthread_cond_signal(&batch->done);
+            pthread_mutex_unlock(&batch->lock);
+        }
+    }
+}
+
+static void parallel_release(ParallelBatch *batch) {
+    if (atomic_fetch_sub(&batch->refs, 1) == 1) {
+        pthread_mutex_destroy(&batch->lock);
+        pthread_cond_destroy(&batch->done);
+        free(batch);
+    }
+}
+
+static void parallel_help(void *arg) {
+    ParallelBatch *batch = arg;
+
+    parallel_drain(batch);
+    parallel_release(batch);
+}
+
+/*
+ * Queues up to one helper per worker but the caller's, then claims indices alongside
+ * them; see parallel_internal.h
+ * Waits only for this call's indices, never for the pool as a whole, so unrelated
+ * tasks on a shared pool cannot hold it up
+ */
+void parallel_for(ThreadPool *pool, size_t tasks, void (*body)(void *context, size_t task), void *context) {
+    size_t helpers = pool && tasks > 1 ? (tasks < pool->count ? tasks : pool->count) - 1 : 0;
+    ParallelBatch *batch = helpers > 0 ? malloc(sizeof(ParallelBatch)) : NULL;
+
+    if (!batch) {
+        for (size_t i = 0; i < tasks; i++) {
+            body(context, i);
+        }
+        return;
+    }
+
+    batch->body = body;
+    batch->context = context;
+    batch->tasks = tasks;
+    atomic_init(&batch->next, 0);
+    atomic_init(&batch->finished, 0);
+    atomic_init(&batch->refs, helpers + 1);
+    pthread_mutex_init(&batch->lock, NULL);
+    pthread_cond_init(&batch->done, NULL);
+
+    // A helper that cannot be queued just leaves its share to the others
+    for (size_t i = 0; i < helpers; i++) {
+        if (tp_submit(pool, parallel_help, batch) != 0) {
+            parallel_release(batch);
+        }
+    }
+
+    parallel_drain(batch);
+
+    // Indices still running on helpers are the only wait left
+    pthread_mutex_lock(&batch->lock);
+    while (atomic_load(&batch->finished) < tasks) {
+        pthread_cond_wait(&batch->done, &batch->lock);
+    }
+    pthread_mutex_unlock(&batch->lock);
+
+    parallel_release(batch);
+}
+
+/*
+ * Returns the worker count, or 1 without a pool
+ */
+size_t parallel_width(ThreadPool *pool) {
+    return pool ? pool->count : 1;
+}
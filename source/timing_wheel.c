@@ -0,0 +1,547 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "functions.h"
+
+#define TW_LEVELS 6             // Six levels of 64 slots cover delays up to 2^36 ticks
+#define TW_SLOT_BITS 6
+#define TW_SLOTS (1 << TW_SLOT_BITS)
+#define TW_SLOT_MASK (TW_SLOTS - 1)
+#define TW_LISTS (TW_LEVELS * TW_SLOTS + 1)     // Every slot plus the expired list
+#define TW_LIST_EXPIRED (TW_LEVELS * TW_SLOTS)
+#define TW_MAX_DELAY (((uint64_t) 1 << (TW_LEVELS * TW_SLOT_BITS)) - 1)
+#define DEFAULT_CAPACITY 1024   // Timer nodes allocated on the first schedule
+#define CHUNK_ITEMS 14          // Node indices per chunk, filling a 64-byte cache line
+#define TW_NIL UINT32_MAX       // Null node or chunk index
+
+/*
+ * One timer. Nodes live in a single pool array and are referred to by index,
+ * so the pool can grow by realloc without invalidating any list
+ */
+typedef struct TimerNode {
+    uint64_t deadline;      // Absolute tick the timer fires on
+    double value;
+    uint32_t position;      // Entry in its slot (chunk * CHUNK_ITEMS + offset), next free node,
+                            // or TW_NIL once cancelled while on the expired list
+    uint32_t generation;    // Bumped on release, so stale handles are rejected
+} TimerNode;
+
+/*
+ * A block of node indices. A list's entries are a chain of chunks in which only
+ * the first may be partly filled, so walking a slot reads whole cache lines of
+ * indices instead of chasing one pointer per timer
+ */
+typedef struct TimerChunk {
+    uint32_t next;          // Next chunk of the same list, or next free chunk
+    uint16_t count;         // Entries in use
+    uint16_t list;          // Owning slot (level * TW_SLOTS + slot) or TW_LIST_EXPIRED
+    uint32_t items[CHUNK_ITEMS];
+} TimerChunk;
+
+/*
+ * Structure for a hierarchical timing wheel
+ * Level L has 64 slots that are each 64^L ticks wide. A timer sits in the level
+ * its remaining delay falls into and is moved down a level (cascaded) when its
+ * slot comes around, so it is touched at most TW_LEVELS times before it fires
+ */
+typedef struct TimingWheel {
+    uint32_t heads[TW_LEVELS * TW_SLOTS];   // First (partly filled) chunk of each slot
+    uint64_t occupied[TW_LEVELS];           // Bit i set while slot i of the level is non-empty
+    TimerNode *nodes;
+    uint32_t capacity;
+    uint32_t used;              // Nodes ever handed out; the rest of the pool is untouched
+    uint32_t free_node;         // Released nodes, reused before untouched ones
+    TimerChunk *chunks;
+    uint32_t chunk_capacity;
+    uint32_t chunks_used;
+    uint32_t free_chunk;
+    uint32_t expired_head;      // Expired timers in firing order, popped from the head chunk
+    uint32_t expired_tail;      // and appended to the tail chunk
+    uint32_t expired_read;      // Entries of the head chunk already popped
+    uint64_t now;               // Last tick processed; every deadline <= now has fired
+    size_t size;                // Scheduled timers not yet popped or cancelled
+} TimingWheel;
+
+/*
+ * Creates an empty timing wheel at tick 0
+ * The timer and chunk pools are allocated on the first schedule
+ */
+TimingWheel *tw_create() {
+    TimingWheel *tw = malloc(sizeof(TimingWheel));
+
+    if (!tw) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < TW_LEVELS * TW_SLOTS; i++) {
+        tw->heads[i] = TW_NIL;
+    }
+    for (size_t i = 0; i < TW_LEVELS; i++) {
+        tw->occupied[i] = 0;
+    }
+
+    tw->nodes = NULL;
+    tw->capacity = 0;
+    tw->used = 0;
+    tw->free_node = TW_NIL;
+    tw->chunks = NULL;
+    tw->chunk_capacity = 0;
+    tw->chunks_used = 0;
+    tw->free_chunk = TW_NIL;
+    tw->expired_head = TW_NIL;
+    tw->expired_tail = TW_NIL;
+    tw->expired_read = 0;
+    tw->now = 0;
+    tw->size = 0;
+
+    return tw;
+}
+
+/*
+ * Frees both pools and the wheel
+ */
+int tw_free(TimingWheel *tw) {
+    if (!tw) {
+        return -1;
+    }
+
+    free(tw->nodes);
+    free(tw->chunks);
+    free(tw);
+
+    return 0;
+}
+
+/*
+ * Doubles the node pool and reserves enough chunks for every node to sit in some list
+ * Each list has at most one partly filled chunk (the expired list two, plus one being
+ * drained), so with this reserve placing or expiring a timer never allocates
+ */
+static int tw_pool_grow(TimingWheel *tw) {
+    uint64_t capacity = tw->capacity ? (uint64_t) tw->capacity * 2 : DEFAULT_CAPACITY;
+
+    if (capacity > TW_NIL / 2) {
+        capacity = TW_NIL / 2;
+    }
+    if (capacity == tw->capacity) {
+        return -1;
+    }
+
+    uint64_t chunk_capacity = capacity / CHUNK_ITEMS + TW_LISTS + 3;
+    TimerChunk *chunks = realloc(tw->chunks, chunk_capacity * sizeof(TimerChunk));
+
+    if (!chunks) {
+        return -1;
+    }
+
+    tw->chunks = chunks;
+    tw->chunk_capacity = (uint32_t) chunk_capacity;
+
+    TimerNode *nodes = realloc(tw->nodes, capacity * sizeof(TimerNode));
+
+    if (!nodes) {
+        return -1;
+    }
+
+    tw->nodes = nodes;
+    tw->capacity = (uint32_t) capacity;
+
+    return 0;
+}
+
+/*
+ * Takes a node from the free list or the untouched end of the pool
+ */
+static uint32_t tw_node_alloc(TimingWheel *tw) {
+    if (tw->free_node != TW_NIL) {
+        uint32_t index = tw->free_node;
+        tw->free_node = tw->nodes[index].position;
+        return index;
+    }
+
+    if (tw->used == tw->capacity && tw_pool_grow(tw) != 0) {
+        return TW_NIL;
+    }
+
+    tw->nodes[tw->used].generation = 0;
+
+    return tw->used++;
+}
+
+/*
+ * Returns a node to the free list; the new generation invalidates its handles
+ */
+static void tw_node_release(TimingWheel *tw, uint32_t index) {
+    tw->nodes[index].generation++;
+    tw->nodes[index].position = tw->free_node;
+    tw->free_node = index;
+}
+
+/*
+ * Takes a chunk from the reserve made by tw_pool_grow, so it cannot fail
+ */
+static uint32_t tw_chunk_alloc(TimingWheel *tw, uint16_t list) {
+    uint32_t index = tw->free_chunk;
+
+    if (index != TW_NIL) {
+        tw->free_chunk = tw->chunks[index].next;
+    } else {
+        index = tw->chunks_used++;
+    }
+
+    tw->chunks[index].next = TW_NIL;
+    tw->chunks[index].count = 0;
+    tw->chunks[index].list = list;
+
+    return index;
+}
+
+static void tw_chunk_release(TimingWheel *tw, uint32_t index) {
+    tw->chunks[index].next = tw->free_chunk;
+    tw->free_chunk = index;
+}
+
+static TimerHandle tw_make_handle(TimingWheel *tw, uint32_t index) {
+    return ((TimerHandle) tw->nodes[index].generation << 32) | index;
+}
+
+/*
+ * Returns the node a handle refers to, or TW_NIL if the handle is stale or was never issued
+ */
+static uint32_t tw_resolve(TimingWheel *tw, TimerHandle handle) {
+    uint32_t index = (uint32_t) handle;
+
+    if (index >= tw->used || tw->nodes[index].generation != (uint32_t) (handle >> 32)) {
+        return TW_NIL;
+    }
+
+    return index;
+}
+
+/*
+ * Places a node in the slot its deadline falls into, relative to the next tick to process
+ * Deadlines beyond the top level are parked in its farthest slot and re-placed when it cascades
+ */
+static void tw_place(TimingWheel *tw, uint32_t index) {
+    TimerNode *node = &tw->nodes[index];
+    uint64_t next = tw->now + 1;
+    uint64_t delay = node->deadline - next;
+    uint64_t deadline = delay > TW_MAX_DELAY ? next + TW_MAX_DELAY : node->deadline;
+    unsigned level = 0;
+
+    while (level < TW_LEVELS - 1 && (delay >> (TW_SLOT_BITS * (level + 1))) != 0) {
+        level++;
+    }
+
+    unsigned slot = (unsigned) (deadline >> (TW_SLOT_BITS * level)) & TW_SLOT_MASK;
+    uint16_t list = (uint16_t) (level * TW_SLOTS + slot);
+    uint32_t head = tw->heads[list];
+
+    if (head == TW_NIL || tw->chunks[head].count == CHUNK_ITEMS) {
+        uint32_t fresh = tw_chunk_alloc(tw, list);
+        tw->chunks[fresh].next = head;
+        tw->heads[list] = head = fresh;
+        tw->occupied[level] |= (uint64_t) 1 << slot;
+    }
+
+    TimerChunk *chunk = &tw->chunks[head];
+    node->position = head * CHUNK_ITEMS + chunk->count;
+    chunk->items[chunk->count++] = index;
+}
+
+/*
+ * Removes a node from its slot by moving the slot's last entry into its place
+ */
+static void tw_slot_remove(TimingWheel *tw, uint32_t index) {
+    uint32_t position = tw->nodes[index].position;
+    uint16_t list = tw->chunks[position / CHUNK_ITEMS].list;
+    uint32_t head = tw->heads[list];
+    TimerChunk *first = &tw->chunks[head];
+    uint32_t last = first->items[--first->count];
+
+    tw->chunks[position / CHUNK_ITEMS].items[position % CHUNK_ITEMS] = last;
+    tw->nodes[last].position = position;
+
+    if (first->count == 0) {
+        tw->heads[list] = first->next;
+        tw_chunk_release(tw, head);
+
+        if (tw->heads[list] == TW_NIL) {
+            tw->occupied[list / TW_SLOTS] &= ~((uint64_t) 1 << (list % TW_SLOTS));
+        }
+    }
+}
+
+/*
+ * Appends a chunk's entries to the expired list; the nodes themselves are not
+ * touched, since a timer is known to have expired from its deadline alone
+ */
+static void tw_expire_chunk(TimingWheel *tw, const TimerChunk *chunk) {
+    for (uint16_t i = 0; i < chunk->count; i++) {
+        uint32_t tail = tw->expired_tail;
+
+        if (tail == TW_NIL || tw->chunks[tail].count == CHUNK_ITEMS) {
+            uint32_t fresh = tw_chunk_alloc(tw, TW_LIST_EXPIRED);
+
+            if (tail != TW_NIL) {
+                tw->chunks[tail].next = fresh;
+            } else {
+                tw->expired_head = fresh;
+            }
+            tw->expired_tail = tail = fresh;
+        }
+
+        TimerChunk *target = &tw->chunks[tail];
+        target->items[target->count++] = chunk->items[i];
+    }
+}
+
+/*
+ * Schedules a timer to fire delay ticks after the current tick, carrying value
+ * A delay of 0 fires on the next tw_advance
+ * Returns TW_INVALID_HANDLE if the pools cannot grow
+ */
+TimerHandle tw_schedule(TimingWheel *tw, uint64_t delay, double value) {
+    if (!tw) {
+        return TW_INVALID_HANDLE;
+    }
+
+    uint32_t index = tw_node_alloc(tw);
+
+    if (index == TW_NIL) {
+        return TW_INVALID_HANDLE;
+    }
+
+    TimerNode *node = &tw->nodes[index];
+    node->deadline = delay > UINT64_MAX - tw->now ? UINT64_MAX : tw->now + delay;
+    node->value = value;
+
+    if (node->deadline <= tw->now) {
+        node->deadline = tw->now + 1;
+    }
+
+    tw_place(tw, index);
+    tw->size++;
+
+    return tw_make_handle(tw, index);
+}
+
+/*
+ * Cancels a pending or expired-but-unpopped timer in O(1)
+ * Returns -1 if the handle is stale, already popped or already cancelled
+ */
+int tw_cancel(TimingWheel *tw, TimerHandle handle) {
+    if (!tw) {
+        return -1;
+    }
+
+    uint32_t index = tw_resolve(tw, handle);
+
+    if (index == TW_NIL) {
+        return -1;
+    }
+
+    if (tw->nodes[index].deadline > tw->now) {
+        tw_slot_remove(tw, index);
+        tw_node_release(tw, index);
+    } else {
+        // Already on the expired list: mark it for tw_pop_expired to skip and release
+        tw->nodes[index].generation++;
+        tw->nodes[index].position = TW_NIL;
+    }
+
+    tw->size--;
+
+    return 0;
+}
+
+/*
+ * Returns 1 if a non-empty slot of some higher level is cascaded on this tick
+ */
+static int tw_cascades_at(TimingWheel *tw, uint64_t tick) {
+    for (unsigned level = 1; level < TW_LEVELS; level++) {
+        unsigned shift = TW_SLOT_BITS * level;
+
+        if ((tick & (((uint64_t) 1 << shift) - 1)) != 0) {
+            return 0;
+        }
+        if (tw->occupied[level] & ((uint64_t) 1 << ((tick >> shift) & TW_SLOT_MASK))) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Returns the first tick in [tick, limit] on which processing has any work to do:
+ * a non-empty level 0 slot, or a cascade of a non-empty slot at a higher level.
+ * Lets tw_advance jump over idle stretches instead of visiting every tick
+ */
+static uint64_t tw_next_event(TimingWheel *tw, uint64_t tick, uint64_t limit) {
+    for (unsigned level = 0; level < TW_LEVELS && tick <= limit; level++) {
+        unsigned shift = TW_SLOT_BITS * level;
+
+        // tick is aligned to this level's slot width, so it may start a turn of a level above
+        if (tw_cascades_at(tw, tick)) {
+            return tick < limit ? tick : limit;
+        }
+
+        uint64_t span = (uint64_t) TW_SLOTS << shift;   // Ticks in one turn of this level
+        uint64_t bits = tw->occupied[level] & (~(uint64_t) 0 << ((tick >> shift) & TW_SLOT_MASK));
+
+        if (bits) {
+            uint64_t event = (tick & ~(span - 1)) + ((uint64_t) __builtin_ctzll(bits) << shift);
+            return event < limit ? event : limit;
+        }
+
+        // Nothing left in this turn; slots below the current index belong to the next turn
+        tick = (tick + span - 1) & ~(span - 1);
+
+        if (tw->occupied[level]) {
+            break;
+        }
+    }
+
+    return tick < limit ? tick : limit;
+}
+
+/*
+ * Empties one slot and returns how many timers it held: level 0 entries move to
+ * the expired list, higher levels are re-placed by their remaining delay. Each
+ * chunk's nodes are prefetched together so their cache misses overlap
+ */
+static size_t tw_drain_slot(TimingWheel *tw, unsigned level, unsigned slot) {
+    uint16_t list = (uint16_t) (level * TW_SLOTS + slot);
+    uint32_t chunk = tw->heads[list];
+    size_t moved = 0;
+
+    tw->heads[list] = TW_NIL;
+    tw->occupied[level] &= ~((uint64_t) 1 << slot);
+
+    while (chunk != TW_NIL) {
+        TimerChunk *current = &tw->chunks[chunk];
+        uint32_t next = current->next;
+
+        if (level == 0) {
+            tw_expire_chunk(tw, current);
+        } else {
+            for (uint16_t i = 0; i < current->count; i++) {
+                __builtin_prefetch(&tw->nodes[current->items[i]]);
+            }
+            for (uint16_t i = 0; i < current->count; i++) {
+                tw_place(tw, current->items[i]);
+            }
+        }
+
+        moved += current->count;
+        tw_chunk_release(tw, chunk);
+        chunk = next;
+    }
+
+    return moved;
+}
+
+/*
+ * Advances the wheel by ticks, moving every timer whose deadline has been reached
+ * onto the expired list in deadline order; retrieve them with tw_pop_expired
+ * Costs O(1) per tick with work plus O(1) per timer moved; idle ticks are skipped
+ * Returns the number of timers that expired
+ */
+size_t tw_advance(TimingWheel *tw, uint64_t ticks) {
+    if (!tw || ticks == 0) {
+        return 0;
+    }
+
+    uint64_t target = ticks > UINT64_MAX - tw->now ? UINT64_MAX : tw->now + ticks;
+    size_t expired = 0;
+
+    while (tw->now < target) {
+        uint64_t tick = tw_next_event(tw, tw->now + 1, target);
+
+        // Cascade every level whose turn starts on this tick, lowest first, placing
+        // timers relative to this tick
+        tw->now = tick - 1;
+
+        for (unsigned level = 1; level < TW_LEVELS; level++) {
+            unsigned shift = TW_SLOT_BITS * level;
+
+            if ((tick & (((uint64_t) 1 << shift) - 1)) != 0) {
+                break;
+            }
+
+            tw_drain_slot(tw, level, (unsigned) (tick >> shift) & TW_SLOT_MASK);
+        }
+
+        expired += tw_drain_slot(tw, 0, (unsigned) tick & TW_SLOT_MASK);
+        tw->now = tick;
+    }
+
+    return expired;
+}
+
+/*
+ * Removes the oldest expired timer and returns its value, storing its handle in *handle if given
+ * Returns NAN if no timer has expired
+ */
+double tw_pop_expired(TimingWheel *tw, TimerHandle *handle) {
+    if (!tw) {
+        return NAN;
+    }
+
+    while (tw->expired_head != TW_NIL) {
+        uint32_t head = tw->expired_head;
+        TimerChunk *chunk = &tw->chunks[head];
+
+        if (tw->expired_read == chunk->count) {
+            tw->expired_head = head == tw->expired_tail ? TW_NIL : chunk->next;
+            if (tw->expired_head == TW_NIL) {
+                tw->expired_tail = TW_NIL;
+            }
+            tw_chunk_release(tw, head);
+            tw->expired_read = 0;
+            continue;
+        }
+
+        uint32_t index = chunk->items[tw->expired_read++];
+
+        if (tw->expired_read + 4 < chunk->count) {
+            __builtin_prefetch(&tw->nodes[chunk->items[tw->expired_read + 4]]);
+        }
+
+        // Cancelled after it expired; the node only waited here to be released
+        if (tw->nodes[index].position == TW_NIL) {
+            tw->nodes[index].position = tw->free_node;
+            tw->free_node = index;
+            continue;
+        }
+
+        double value = tw->nodes[index].value;
+
+        if (handle) {
+            *handle = tw_make_handle(tw, index);
+        }
+
+        tw_node_release(tw, index);
+        tw->size--;
+
+        return value;
+    }
+
+    return NAN;
+}
+
+/*
+ * Returns the last tick processed by tw_advance
+ */
+uint64_t tw_now(TimingWheel *tw) {
+    return tw ? tw->now : 0;
+}
+
+/*
+ * Returns the number of timers scheduled and not yet popped or cancelled
+ */
+size_t tw_size(TimingWheel *tw) {
+    return tw ? tw->size : 0;
+}
@@ -0,0 +1,236 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "functions.h"
+
+#define DEFAULT_CAPACITY 64     // Slots in the first ring when the caller passes 0
+#define CACHE_LINE 64           // top and bottom live on separate lines to avoid false sharing
+
+/*
+ * One circular buffer of item slots; its size is a power of two so an index is masked, not divided
+ * Replaced buffers are kept on a retired list until the deque is freed, because a
+ * thief that loaded the old pointer may still be reading from it
+ */
+typedef struct WsdBuffer {
+    struct WsdBuffer *retired;  // Next older buffer, only used once this one is replaced
+    size_t mask;                // Slot count - 1
+    _Atomic(void *) items[];
+} WsdBuffer;
+
+/*
+ * Structure for a Chase-Lev work-stealing deque
+ * The owning thread pushes and pops at the bottom like a stack; any other thread
+ * steals from the top like a queue, competing only through a CAS on top
+ * Indices grow without bound and are masked into the ring, as in the circular Queue
+ */
+typedef struct WsDeque {
+    _Alignas(CACHE_LINE) _Atomic(int64_t) top;
+    _Alignas(CACHE_LINE) _Atomic(int64_t) bottom;
+    _Atomic(WsdBuffer *) buffer;
+    WsdBuffer *retired;         // Buffers replaced by growth, freed with the deque
+} WsDeque;
+
+static WsdBuffer *wsd_buffer_create(size_t capacity) {
+    WsdBuffer *buffer = malloc(sizeof(WsdBuffer) + capacity * sizeof(_Atomic(void *)));
+
+    if (!buffer) {
+        return NULL;
+    }
+
+    buffer->retired = NULL;
+    buffer->mask = capacity - 1;
+
+    return buffer;
+}
+
+/*
+ * Creates an empty deque whose ring starts with capacity slots (rounded up to a power of two)
+ */
+WsDeque *wsd_create(size_t capacity) {
+    if (capacity == 0) {
+        capacity = DEFAULT_CAPACITY;
+    }
+
+    size_t rounded = 1;
+
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+
+    WsDeque *d = aligned_alloc(CACHE_LINE, sizeof(WsDeque));
+
+    if (!d) {
+        return NULL;
+    }
+
+    WsdBuffer *buffer = wsd_buffer_create(rounded);
+
+    if (!buffer) {
+        free(d);
+        return NULL;
+    }
+
+    atomic_init(&d->top, 0);
+    atomic_init(&d->bottom, 0);
+    atomic_init(&d->buffer, buffer);
+    d->retired = NULL;
+
+    return d;
+}
+
+/*
+ * Frees the deque, its ring and every retired ring; items still queued are not touched
+ * No other thread may be using the deque at this point
+ */
+int wsd_free(WsDeque *d) {
+    if (!d) {
+        return -1;
+    }
+
+    free(atomic_load_explicit(&d->buffer, memory_order_relaxed));
+
+    while (d->retired) {
+        WsdBuffer *next = d->retired->retired;
+        free(d->retired);
+        d->retired = next;
+    }
+
+    free(d);
+
+    return 0;
+}
+
+/*
+ * Copies the live range [top, bottom) into a ring twice the size and publishes it
+ * Thieves never wait: until the new pointer is visible they keep reading the old
+ * ring, whose slots in the live range are left unchanged
+ */
+static WsdBuffer *wsd_grow(WsDeque *d, WsdBuffer *old, int64_t top, int64_t bottom) {
+    WsdBuffer *buffer = wsd_buffer_create((old->mask + 1) * 2);
+
+    if (!buffer) {
+        return NULL;
+    }
+
+    for (int64_t i = top; i < bottom; i++) {
+        void *item = atomic_load_explicit(&old->items[i & old->mask], memory_order_relaxed);
+        atomic_store_explicit(&buffer->items[i & buffer->mask], item, memory_order_relaxed);
+    }
+
+    old->retired = d->retired;
+    d->retired = old;
+    atomic_store_explicit(&d->buffer, buffer, memory_order_release);
+
+    return buffer;
+}
+
+/*
+ * Pushes an item at the bottom; only the owning thread may call this
+ * Returns -1 if item is NULL or the ring is full and cannot grow
+ */
+int wsd_push(WsDeque *d, void *item) {
+    if (!d || !item) {
+        return -1;
+    }
+
+    int64_t bottom = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&d->top, memory_order_acquire);
+    WsdBuffer *buffer = atomic_load_explicit(&d->buffer, memory_order_relaxed);
+
+    if (bottom - top > (int64_t) buffer->mask) {
+        buffer = wsd_grow(d, buffer, top, bottom);
+
+        if (!buffer) {
+            return -1;
+        }
+    }
+
+    atomic_store_explicit(&buffer->items[bottom & buffer->mask], item, memory_order_relaxed);
+
+    // Release: the item must be visible before a thief can see the new bottom
+    atomic_store_explicit(&d->bottom, bottom + 1, memory_order_release);
+
+    return 0;
+}
+
+/*
+ * Pops the most recently pushed item; only the owning thread may call this
+ * Returns NULL if the deque is empty or a thief took the last item first
+ */
+void *wsd_pop(WsDeque *d) {
+    if (!d) {
+        return NULL;
+    }
+
+    int64_t bottom = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    WsdBuffer *buffer = atomic_load_explicit(&d->buffer, memory_order_relaxed);
+
+    // Claim the slot before reading top, so a concurrent thief either sees the claim or wins the CAS
+    atomic_store_explicit(&d->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    int64_t top = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        // Already empty; undo the claim
+        atomic_store_explicit(&d->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    void *item = atomic_load_explicit(&buffer->items[bottom & buffer->mask], memory_order_relaxed);
+
+    if (top == bottom) {
+        // Last item: race the thieves for it through top
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &top, top + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed)) {
+            item = NULL;
+        }
+        atomic_store_explicit(&d->bottom, bottom + 1, memory_order_relaxed);
+    }
+
+    return item;
+}
+
+/*
+ * Takes the oldest item; any thread may call this
+ * Returns NULL if the deque is empty or another thread won the race for the item,
+ * in which case the caller should move on to another victim
+ */
+void *wsd_steal(WsDeque *d) {
+    if (!d) {
+        return NULL;
+    }
+
+    int64_t top = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t bottom = atomic_load_explicit(&d->bottom, memory_order_acquire);
+
+    if (top >= bottom) {
+        return NULL;
+    }
+
+    WsdBuffer *buffer = atomic_load_explicit(&d->buffer, memory_order_acquire);
+    void *item = atomic_load_explicit(&buffer->items[top & buffer->mask], memory_order_relaxed);
+
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &top, top + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+
+    return item;
+}
+
+/*
+ * Returns the number of queued items; only a snapshot while other threads are active
+ */
+size_t wsd_size(WsDeque *d) {
+    if (!d) {
+        return 0;
+    }
+
+    int64_t bottom = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    return bottom > top ? (size_t) (bottom - top) : 0;
+}